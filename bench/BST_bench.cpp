@@ -0,0 +1,280 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../lib/BST.h"
+
+#ifndef BST_BENCH_MAX_SIZE
+#define BST_BENCH_MAX_SIZE 1000000
+#endif
+
+typedef BST<int, std::allocator<Node<int> >, RedBlackPolicy> Tree;
+typedef std::set<int> Set;
+typedef std::map<int, int> Map;
+
+static constexpr uint32_t seed = 20240601;
+
+static void Sizes(benchmark::internal::Benchmark* bench) {
+    bench->RangeMultiplier(10)->Range(1000, BST_BENCH_MAX_SIZE)->Unit(benchmark::kMicrosecond);
+}
+
+// the even numbers below 2n in a fixed shuffled order, so odd keys are always misses
+static std::vector<int> RandomKeys(size_t n) {
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = static_cast<int>(2 * i);
+    }
+    std::mt19937 gen(seed);
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    return keys;
+}
+
+// ranks drawn by inverting the continuous Zipf CDF with s = 0.99, then scattered over the key space
+// by an odd multiplier so the hot keys are not neighbours
+static std::vector<int> ZipfKeys(size_t n) {
+    const double s = 0.99;
+    const double top = std::pow(static_cast<double>(n) + 1.0, 1.0 - s) - 1.0;
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        double rank = std::pow(top * uniform(gen) + 1.0, 1.0 / (1.0 - s)) - 1.0;
+        uint32_t r = std::min(static_cast<uint32_t>(rank), static_cast<uint32_t>(n - 1));
+        keys[i] = static_cast<int>(r * 2654435761u);
+    }
+
+    return keys;
+}
+
+static void Add(Tree& tree, int key) { tree.insert(key); }
+static void Add(Set& set, int key) { set.insert(key); }
+static void Add(Map& map, int key) { map.emplace(key, key); }
+
+template<typename Container>
+static Container Build(const std::vector<int>& keys) {
+    Container c;
+    for (int key : keys) {
+        Add(c, key);
+    }
+
+    return c;
+}
+
+static int Key(int key) { return key; }
+static int Key(const Map::value_type& entry) { return entry.first; }
+
+static bool Found(const Tree& tree, int key) { return tree.find(key) != tree.cend<TraverseTag::In>(); }
+
+template<typename Container>
+static bool Found(const Container& c, int key) { return c.find(key) != c.end(); }
+
+template<typename Container>
+static void Insert(benchmark::State& state, const std::vector<int>& keys) {
+    for (auto _ : state) {
+        Container c;
+        for (int key : keys) {
+            Add(c, key);
+        }
+        benchmark::DoNotOptimize(c.size());
+        state.PauseTiming();
+        c.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(keys.size()));
+}
+
+template<typename Container>
+static void BM_InsertRandom(benchmark::State& state) {
+    Insert<Container>(state, RandomKeys(state.range(0)));
+}
+
+template<typename Container>
+static void BM_InsertSorted(benchmark::State& state) {
+    std::vector<int> keys = RandomKeys(state.range(0));
+    std::sort(keys.begin(), keys.end());
+    Insert<Container>(state, keys);
+}
+
+template<typename Container>
+static void BM_InsertZipf(benchmark::State& state) {
+    Insert<Container>(state, ZipfKeys(state.range(0)));
+}
+
+// offset 0 looks up stored keys, offset 1 the odd keys between them
+template<typename Container, int offset>
+static void BM_Find(benchmark::State& state) {
+    std::vector<int> keys = RandomKeys(state.range(0));
+    Container c = Build<Container>(keys);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(seed + 1));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Found(c, keys[i] + offset));
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Container>
+static void BM_LowerBound(benchmark::State& state) {
+    std::vector<int> keys = RandomKeys(state.range(0));
+    const Container c = Build<Container>(keys);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(c.lower_bound(keys[i]));
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Container>
+static void BM_UpperBound(benchmark::State& state) {
+    std::vector<int> keys = RandomKeys(state.range(0));
+    const Container c = Build<Container>(keys);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(c.upper_bound(keys[i]));
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Container>
+static void BM_Erase(benchmark::State& state) {
+    std::vector<int> keys = RandomKeys(state.range(0));
+    std::vector<int> order(keys);
+    std::shuffle(order.begin(), order.end(), std::mt19937(seed + 2));
+    for (auto _ : state) {
+        state.PauseTiming();
+        Container c = Build<Container>(keys);
+        state.ResumeTiming();
+        for (int key : order) {
+            c.erase(key);
+        }
+        benchmark::DoNotOptimize(c.size());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(keys.size()));
+}
+
+template<typename Container>
+static void BM_Copy(benchmark::State& state) {
+    const Container c = Build<Container>(RandomKeys(state.range(0)));
+    for (auto _ : state) {
+        Container copy(c);
+        benchmark::DoNotOptimize(copy.size());
+        state.PauseTiming();
+        copy.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(c.size()));
+}
+
+// moves every key of one tree into another holding the interleaved keys
+template<typename Container>
+static void BM_Merge(benchmark::State& state) {
+    std::vector<int> keys = RandomKeys(state.range(0));
+    std::vector<int> odd(keys);
+    for (int& key : odd) {
+        ++key;
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        Container c = Build<Container>(keys);
+        Container other = Build<Container>(odd);
+        state.ResumeTiming();
+        c.merge(other);
+        benchmark::DoNotOptimize(c.size());
+        state.PauseTiming();
+        c.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(odd.size()));
+}
+
+template<typename Container>
+static void BM_Clear(benchmark::State& state) {
+    std::vector<int> keys = RandomKeys(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        Container c = Build<Container>(keys);
+        state.ResumeTiming();
+        c.clear();
+        benchmark::DoNotOptimize(c.size());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(keys.size()));
+}
+
+template<TraverseTag tag, bool reverse>
+static void BM_TreeIterate(benchmark::State& state) {
+    const Tree tree = Build<Tree>(RandomKeys(state.range(0)));
+    for (auto _ : state) {
+        int64_t sum = 0;
+        if (reverse) {
+            for (auto it = tree.crbegin<tag>(); it != tree.crend<tag>(); ++it) {
+                sum += *it;
+            }
+        } else {
+            for (auto it = tree.cbegin<tag>(); it != tree.cend<tag>(); ++it) {
+                sum += *it;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tree.size()));
+}
+
+template<typename Container, bool reverse>
+static void BM_StdIterate(benchmark::State& state) {
+    const Container c = Build<Container>(RandomKeys(state.range(0)));
+    for (auto _ : state) {
+        int64_t sum = 0;
+        if (reverse) {
+            for (auto it = c.rbegin(); it != c.rend(); ++it) {
+                sum += Key(*it);
+            }
+        } else {
+            for (auto it = c.begin(); it != c.end(); ++it) {
+                sum += Key(*it);
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(c.size()));
+}
+
+// every operation runs on BST and on the std::set and std::map baselines
+#define BST_BENCHMARK(name, ...)                                 \
+    BENCHMARK_TEMPLATE(name, Tree, ##__VA_ARGS__)->Apply(Sizes); \
+    BENCHMARK_TEMPLATE(name, Set, ##__VA_ARGS__)->Apply(Sizes);  \
+    BENCHMARK_TEMPLATE(name, Map, ##__VA_ARGS__)->Apply(Sizes)
+
+BST_BENCHMARK(BM_InsertRandom);
+BST_BENCHMARK(BM_InsertSorted);
+BST_BENCHMARK(BM_InsertZipf);
+BST_BENCHMARK(BM_Find, 0);
+BST_BENCHMARK(BM_Find, 1);
+BST_BENCHMARK(BM_LowerBound);
+BST_BENCHMARK(BM_UpperBound);
+BST_BENCHMARK(BM_Erase);
+BST_BENCHMARK(BM_Copy);
+BST_BENCHMARK(BM_Merge);
+BST_BENCHMARK(BM_Clear);
+
+BENCHMARK_TEMPLATE(BM_TreeIterate, TraverseTag::In, false)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_TreeIterate, TraverseTag::In, true)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_TreeIterate, TraverseTag::Pre, false)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_TreeIterate, TraverseTag::Pre, true)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_TreeIterate, TraverseTag::Post, false)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_TreeIterate, TraverseTag::Post, true)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_StdIterate, Set, false)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_StdIterate, Set, true)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_StdIterate, Map, false)->Apply(Sizes);
+BENCHMARK_TEMPLATE(BM_StdIterate, Map, true)->Apply(Sizes);
+
+BENCHMARK_MAIN();
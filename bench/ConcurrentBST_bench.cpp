@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "../lib/ConcurrentBST.h"
+
+static constexpr int key_range = 1 << 20;
+
+static ConcurrentBST<int>* concurrent_tree = nullptr;
+static BST<int, std::allocator<Node<int> >, RedBlackPolicy>* locked_tree = nullptr;
+static std::mutex tree_mutex;
+
+static void ThreadsUpToHardware(benchmark::internal::Benchmark* bench) {
+    int hardware = static_cast<int>(std::thread::hardware_concurrency());
+    for (int threads = 1; threads < hardware; threads *= 2) {
+        bench->Threads(threads);
+    }
+    bench->Threads(hardware > 0 ? hardware : 1);
+}
+
+// 50% contains, 25% insert, 25% erase over a tree kept around half full
+static void BM_ConcurrentBSTMixed(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        concurrent_tree = new ConcurrentBST<int>();
+        std::mt19937 gen(1);
+        for (int i = 0; i < key_range / 2; ++i) {
+            concurrent_tree->insert(static_cast<int>(gen() % key_range));
+        }
+    }
+    std::mt19937 gen(state.thread_index() + 7);
+    for (auto _ : state) {
+        int key = static_cast<int>(gen() % key_range);
+        unsigned op = gen() % 4;
+        if (op < 2) {
+            benchmark::DoNotOptimize(concurrent_tree->contains(key));
+        } else if (op == 2) {
+            benchmark::DoNotOptimize(concurrent_tree->insert(key));
+        } else {
+            benchmark::DoNotOptimize(concurrent_tree->erase(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete concurrent_tree;
+    }
+}
+
+static void BM_MutexBSTMixed(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        locked_tree = new BST<int, std::allocator<Node<int> >, RedBlackPolicy>();
+        std::mt19937 gen(1);
+        for (int i = 0; i < key_range / 2; ++i) {
+            locked_tree->insert(static_cast<int>(gen() % key_range));
+        }
+    }
+    std::mt19937 gen(state.thread_index() + 7);
+    for (auto _ : state) {
+        int key = static_cast<int>(gen() % key_range);
+        unsigned op = gen() % 4;
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        if (op < 2) {
+            benchmark::DoNotOptimize(locked_tree->find(key));
+        } else if (op == 2) {
+            benchmark::DoNotOptimize(locked_tree->insert(key));
+        } else {
+            benchmark::DoNotOptimize(locked_tree->erase(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete locked_tree;
+    }
+}
+
+BENCHMARK(BM_ConcurrentBSTMixed)->Apply(ThreadsUpToHardware)->UseRealTime();
+BENCHMARK(BM_MutexBSTMixed)->Apply(ThreadsUpToHardware)->UseRealTime();
+
+BENCHMARK_MAIN();
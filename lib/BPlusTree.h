@@ -0,0 +1,712 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "BST.h"
+
+inline unsigned bplus_lane_mask(size_t remaining, size_t lanes) {
+    return remaining >= lanes ? (1u << lanes) - 1 : (1u << remaining) - 1;
+}
+
+#if defined(__AVX2__)
+inline size_t bplus_count_less(const int32_t* keys, size_t n, int32_t key) {
+    const __m256i needle = _mm256_set1_epi32(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 8) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, chunk))));
+        mask &= bplus_lane_mask(n - i, 8);
+        result += std::popcount(mask);
+        if (mask != 0xFFu) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+inline size_t bplus_count_less(const int64_t* keys, size_t n, int64_t key) {
+    const __m256i needle = _mm256_set1_epi64x(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 4) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(needle, chunk))));
+        mask &= bplus_lane_mask(n - i, 4);
+        result += std::popcount(mask);
+        if (mask != 0xFu) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+inline size_t bplus_count_less(const float* keys, size_t n, float key) {
+    const __m256 needle = _mm256_set1_ps(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 8) {
+        __m256 chunk = _mm256_loadu_ps(keys + i);
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(chunk, needle, _CMP_LT_OQ)));
+        mask &= bplus_lane_mask(n - i, 8);
+        result += std::popcount(mask);
+        if (mask != 0xFFu) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+inline size_t bplus_count_less(const double* keys, size_t n, double key) {
+    const __m256d needle = _mm256_set1_pd(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 4) {
+        __m256d chunk = _mm256_loadu_pd(keys + i);
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(chunk, needle, _CMP_LT_OQ)));
+        mask &= bplus_lane_mask(n - i, 4);
+        result += std::popcount(mask);
+        if (mask != 0xFu) {
+            break;
+        }
+    }
+
+    return result;
+}
+#elif defined(__SSE2__)
+inline size_t bplus_count_less(const int32_t* keys, size_t n, int32_t key) {
+    const __m128i needle = _mm_set1_epi32(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 4) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(needle, chunk))));
+        mask &= bplus_lane_mask(n - i, 4);
+        result += std::popcount(mask);
+        if (mask != 0xFu) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+#if defined(__SSE4_2__)
+inline size_t bplus_count_less(const int64_t* keys, size_t n, int64_t key) {
+    const __m128i needle = _mm_set1_epi64x(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(needle, chunk))));
+        mask &= bplus_lane_mask(n - i, 2);
+        result += std::popcount(mask);
+        if (mask != 0x3u) {
+            break;
+        }
+    }
+
+    return result;
+}
+#endif
+
+inline size_t bplus_count_less(const float* keys, size_t n, float key) {
+    const __m128 needle = _mm_set1_ps(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 4) {
+        __m128 chunk = _mm_loadu_ps(keys + i);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmplt_ps(chunk, needle)));
+        mask &= bplus_lane_mask(n - i, 4);
+        result += std::popcount(mask);
+        if (mask != 0xFu) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+inline size_t bplus_count_less(const double* keys, size_t n, double key) {
+    const __m128d needle = _mm_set1_pd(key);
+    size_t result = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        __m128d chunk = _mm_loadu_pd(keys + i);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_pd(_mm_cmplt_pd(chunk, needle)));
+        mask &= bplus_lane_mask(n - i, 2);
+        result += std::popcount(mask);
+        if (mask != 0x3u) {
+            break;
+        }
+    }
+
+    return result;
+}
+#endif
+
+template<typename T, typename Compare = std::less<T>, size_t NodeKeys = 32>
+class BPlusTree {
+    static_assert(NodeKeys >= 8 && NodeKeys % 8 == 0, "NodeKeys must be a multiple of 8");
+
+    struct node_base {
+        size_t count;
+        bool leaf;
+    };
+
+    struct leaf_node : node_base {
+        alignas(32) T keys[NodeKeys];
+        leaf_node* prev;
+        leaf_node* next;
+
+        leaf_node() : node_base{0, true}, keys(), prev(nullptr), next(nullptr) {}
+    };
+
+    struct inner_node : node_base {
+        alignas(32) T keys[NodeKeys];
+        node_base* children[NodeKeys + 1];
+
+        inner_node() : node_base{0, false}, keys(), children() {}
+    };
+
+    static constexpr size_t max_depth = 64;
+
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    static constexpr bool simd_search = (std::is_same_v<Compare, std::less<T> > || std::is_same_v<Compare, std::less<> >)
+                                        && requires(const T* keys, T key) { bplus_count_less(keys, size_t(), key); };
+
+    class leaf_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        leaf_iterator() : tree_(nullptr), leaf_(nullptr), index_(0) {}
+
+        reference operator*() const { return leaf_->keys[index_]; }
+        pointer operator->() const { return &leaf_->keys[index_]; }
+
+        leaf_iterator& operator++() {
+            if (++index_ == leaf_->count) {
+                leaf_ = leaf_->next;
+                index_ = 0;
+            }
+
+            return *this;
+        }
+
+        leaf_iterator operator++(int) {
+            leaf_iterator temp = *this;
+            ++*this;
+
+            return temp;
+        }
+
+        leaf_iterator& operator--() {
+            if (leaf_ == nullptr) {
+                leaf_ = tree_->last_;
+                index_ = leaf_->count - 1;
+            } else if (index_ == 0) {
+                leaf_ = leaf_->prev;
+                index_ = leaf_->count - 1;
+            } else {
+                --index_;
+            }
+
+            return *this;
+        }
+
+        leaf_iterator operator--(int) {
+            leaf_iterator temp = *this;
+            --*this;
+
+            return temp;
+        }
+
+        bool operator==(const leaf_iterator& other) const { return leaf_ == other.leaf_ && index_ == other.index_; }
+        bool operator!=(const leaf_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class BPlusTree;
+
+        leaf_iterator(const BPlusTree* tree, leaf_node* leaf, size_type index) : tree_(tree), leaf_(leaf), index_(index) {}
+
+        const BPlusTree* tree_;
+        leaf_node* leaf_;
+        size_type index_;
+    };
+
+    template<TraverseTag tag>
+    using iterator = leaf_iterator;
+
+    template<TraverseTag tag>
+    using const_iterator = leaf_iterator;
+
+    template<TraverseTag tag>
+    using reverse_iterator = std::reverse_iterator<leaf_iterator>;
+
+    template<TraverseTag tag>
+    using const_reverse_iterator = std::reverse_iterator<leaf_iterator>;
+
+    BPlusTree() : root_(nullptr), first_(nullptr), last_(nullptr), size_(0), compare_() {}
+
+    explicit BPlusTree(const Compare& compare)
+        : root_(nullptr), first_(nullptr), last_(nullptr), size_(0), compare_(compare) {}
+
+    BPlusTree(const BPlusTree& other)
+        : root_(nullptr), first_(nullptr), last_(nullptr), size_(0), compare_(other.compare_) {
+            copy_from(other);
+        }
+
+    BPlusTree(BPlusTree&& other) noexcept
+        : root_(other.root_), first_(other.first_), last_(other.last_), size_(other.size_),
+          compare_(std::move(other.compare_)) {
+            other.root_ = nullptr;
+            other.first_ = nullptr;
+            other.last_ = nullptr;
+            other.size_ = 0;
+        }
+
+    template<typename InputIt>
+    BPlusTree(InputIt i, InputIt j) : root_(nullptr), first_(nullptr), last_(nullptr), size_(0), compare_() {
+        insert(i, j);
+    }
+
+    BPlusTree(std::initializer_list<value_type> il)
+        : root_(nullptr), first_(nullptr), last_(nullptr), size_(0), compare_() {
+            insert(il);
+        }
+
+    ~BPlusTree() { clear(); }
+
+    BPlusTree& operator=(const BPlusTree& other) {
+        if (this == &other) {
+            return *this;
+        }
+        clear();
+        compare_ = other.compare_;
+        copy_from(other);
+
+        return *this;
+    }
+
+    BPlusTree& operator=(BPlusTree&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        clear();
+        swap(other);
+
+        return *this;
+    }
+
+    bool operator==(const BPlusTree& other) const {
+        return size_ == other.size_ && std::equal(cbegin<TraverseTag::In>(), cend<TraverseTag::In>(), other.cbegin<TraverseTag::In>());
+    }
+
+    bool operator!=(const BPlusTree& other) const { return !(*this == other); }
+
+    void swap(BPlusTree& other) noexcept {
+        std::swap(root_, other.root_);
+        std::swap(first_, other.first_);
+        std::swap(last_, other.last_);
+        std::swap(size_, other.size_);
+        std::swap(compare_, other.compare_);
+    }
+
+    friend void swap(BPlusTree& lhs, BPlusTree& rhs) noexcept { lhs.swap(rhs); }
+
+    size_type size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_type max_size() const { return std::numeric_limits<size_type>::max(); }
+
+    key_compare key_comp() const { return compare_; }
+
+    value_compare value_comp() const { return compare_; }
+
+    template<TraverseTag tag>
+    leaf_iterator begin() const {
+        static_assert(tag == TraverseTag::In, "BPlusTree only keeps the in-order sequence");
+
+        return leaf_iterator(this, first_, 0);
+    }
+
+    template<TraverseTag tag>
+    leaf_iterator end() const {
+        static_assert(tag == TraverseTag::In, "BPlusTree only keeps the in-order sequence");
+
+        return leaf_iterator(this, nullptr, 0);
+    }
+
+    template<TraverseTag tag>
+    leaf_iterator cbegin() const { return begin<tag>(); }
+
+    template<TraverseTag tag>
+    leaf_iterator cend() const { return end<tag>(); }
+
+    template<TraverseTag tag>
+    std::reverse_iterator<leaf_iterator> rbegin() const { return std::reverse_iterator<leaf_iterator>(end<tag>()); }
+
+    template<TraverseTag tag>
+    std::reverse_iterator<leaf_iterator> rend() const { return std::reverse_iterator<leaf_iterator>(begin<tag>()); }
+
+    template<TraverseTag tag>
+    std::reverse_iterator<leaf_iterator> crbegin() const { return rbegin<tag>(); }
+
+    template<TraverseTag tag>
+    std::reverse_iterator<leaf_iterator> crend() const { return rend<tag>(); }
+
+    void clear() {
+        if (root_ != nullptr) {
+            destroy(root_);
+        }
+        root_ = nullptr;
+        first_ = nullptr;
+        last_ = nullptr;
+        size_ = 0;
+    }
+
+    std::pair<leaf_iterator, bool> insert_check(const value_type& value) { return insert_key(value); }
+
+    leaf_iterator insert(const value_type& value) { return insert_key(value).first; }
+
+    leaf_iterator insert(value_type&& value) { return insert_key(std::move(value)).first; }
+
+    void insert(std::initializer_list<value_type> il) {
+        for (const auto& value : il) {
+            insert(value);
+        }
+    }
+
+    template<class InputIt>
+    void insert(InputIt i, InputIt j) {
+        for (; i != j; ++i) {
+            insert(*i);
+        }
+    }
+
+    size_type erase(const value_type& value) {
+        path_type path;
+        leaf_node* leaf = find_leaf(value, path);
+        if (leaf == nullptr) {
+            return 0;
+        }
+        size_type index = count_less(leaf->keys, leaf->count, value);
+        if (index == leaf->count || compare_(value, leaf->keys[index])) {
+            return 0;
+        }
+        erase_at(leaf, index, path);
+
+        return 1;
+    }
+
+    leaf_iterator erase(leaf_iterator q) {
+        if (q.leaf_ == nullptr) {
+            return end<TraverseTag::In>();
+        }
+        path_type path;
+        find_leaf(*q, path);
+
+        return erase_at(q.leaf_, q.index_, path);
+    }
+
+    bool contains(const value_type& k) const { return find(k).leaf_ != nullptr; }
+
+    leaf_iterator find(const value_type& k) const {
+        path_type path;
+        leaf_node* leaf = find_leaf(k, path);
+        if (leaf == nullptr) {
+            return end<TraverseTag::In>();
+        }
+        size_type index = count_less(leaf->keys, leaf->count, k);
+        if (index == leaf->count || compare_(k, leaf->keys[index])) {
+            return end<TraverseTag::In>();
+        }
+
+        return leaf_iterator(this, leaf, index);
+    }
+
+    leaf_iterator lower_bound(const value_type& k) const {
+        leaf_iterator it = find(k);
+        if (it.leaf_ == nullptr || it == begin<TraverseTag::In>()) {
+            return end<TraverseTag::In>();
+        }
+
+        return --it;
+    }
+
+    leaf_iterator upper_bound(const value_type& k) const {
+        leaf_iterator it = find(k);
+        if (it.leaf_ == nullptr) {
+            return it;
+        }
+
+        return ++it;
+    }
+
+private:
+    struct path_type {
+        inner_node* nodes[max_depth];
+        size_type slots[max_depth];
+        size_type depth = 0;
+    };
+
+    size_type count_less(const T* keys, size_type n, const T& key) const {
+        if constexpr (simd_search) {
+            return bplus_count_less(keys, n, key);
+        } else {
+            return std::lower_bound(keys, keys + n, key, compare_) - keys;
+        }
+    }
+
+    // separator keys[i] sends keys not less than it to children[i + 1]
+    size_type child_index(const inner_node* inner, const T& key) const {
+        size_type index = count_less(inner->keys, inner->count, key);
+        if (index < inner->count && !compare_(key, inner->keys[index])) {
+            ++index;
+        }
+
+        return index;
+    }
+
+    leaf_node* find_leaf(const T& key, path_type& path) const {
+        node_base* node = root_;
+        if (node == nullptr) {
+            return nullptr;
+        }
+        while (!node->leaf) {
+            inner_node* inner = static_cast<inner_node*>(node);
+            size_type index = child_index(inner, key);
+            path.nodes[path.depth] = inner;
+            path.slots[path.depth] = index;
+            ++path.depth;
+            node = inner->children[index];
+        }
+
+        return static_cast<leaf_node*>(node);
+    }
+
+    template<typename V>
+    std::pair<leaf_iterator, bool> insert_key(V&& value) {
+        if (root_ == nullptr) {
+            leaf_node* leaf = new leaf_node();
+            leaf->keys[0] = std::forward<V>(value);
+            leaf->count = 1;
+            root_ = leaf;
+            first_ = leaf;
+            last_ = leaf;
+            size_ = 1;
+
+            return {leaf_iterator(this, leaf, 0), true};
+        }
+        path_type path;
+        leaf_node* leaf = find_leaf(value, path);
+        size_type index = count_less(leaf->keys, leaf->count, value);
+        if (index < leaf->count && !compare_(value, leaf->keys[index])) {
+            return {leaf_iterator(this, leaf, index), false};
+        }
+        ++size_;
+        if (leaf->count < NodeKeys) {
+            shift_in(leaf->keys, leaf->count, index, std::forward<V>(value));
+            ++leaf->count;
+
+            return {leaf_iterator(this, leaf, index), true};
+        }
+        leaf_node* right = new leaf_node();
+        size_type half = NodeKeys / 2;
+        std::move(leaf->keys + half, leaf->keys + NodeKeys, right->keys);
+        right->count = NodeKeys - half;
+        leaf->count = half;
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next != nullptr) {
+            leaf->next->prev = right;
+        } else {
+            last_ = right;
+        }
+        leaf->next = right;
+        leaf_node* target = leaf;
+        if (index > half) {
+            target = right;
+            index -= half;
+        }
+        shift_in(target->keys, target->count, index, std::forward<V>(value));
+        ++target->count;
+        leaf_iterator result(this, target, index);
+
+        T separator = right->keys[0];
+        node_base* child = right;
+        while (path.depth > 0) {
+            --path.depth;
+            inner_node* parent = path.nodes[path.depth];
+            size_type slot = path.slots[path.depth];
+            if (parent->count < NodeKeys) {
+                shift_in(parent->keys, parent->count, slot, std::move(separator));
+                std::move_backward(parent->children + slot + 1, parent->children + parent->count + 1,
+                                   parent->children + parent->count + 2);
+                parent->children[slot + 1] = child;
+                ++parent->count;
+
+                return {result, true};
+            }
+            inner_node* sibling = new inner_node();
+            size_type mid = NodeKeys / 2;
+            T up = std::move(parent->keys[mid]);
+            std::move(parent->keys + mid + 1, parent->keys + NodeKeys, sibling->keys);
+            std::copy(parent->children + mid + 1, parent->children + NodeKeys + 1, sibling->children);
+            sibling->count = NodeKeys - mid - 1;
+            parent->count = mid;
+            inner_node* owner = parent;
+            if (slot > mid) {
+                owner = sibling;
+                slot -= mid + 1;
+            }
+            shift_in(owner->keys, owner->count, slot, std::move(separator));
+            std::move_backward(owner->children + slot + 1, owner->children + owner->count + 1,
+                               owner->children + owner->count + 2);
+            owner->children[slot + 1] = child;
+            ++owner->count;
+            separator = std::move(up);
+            child = sibling;
+        }
+        inner_node* root = new inner_node();
+        root->keys[0] = std::move(separator);
+        root->children[0] = root_;
+        root->children[1] = child;
+        root->count = 1;
+        root_ = root;
+
+        return {result, true};
+    }
+
+    template<typename V>
+    static void shift_in(T* keys, size_type count, size_type index, V&& value) {
+        std::move_backward(keys + index, keys + count, keys + count + 1);
+        keys[index] = std::forward<V>(value);
+    }
+
+    leaf_iterator erase_at(leaf_node* leaf, size_type index, path_type& path) {
+        std::move(leaf->keys + index + 1, leaf->keys + leaf->count, leaf->keys + index);
+        --leaf->count;
+        --size_;
+        if (leaf->count != 0) {
+            if (index < leaf->count) {
+                return leaf_iterator(this, leaf, index);
+            }
+
+            return leaf_iterator(this, leaf->next, 0);
+        }
+        leaf_node* next = leaf->next;
+        if (leaf->prev != nullptr) {
+            leaf->prev->next = next;
+        } else {
+            first_ = next;
+        }
+        if (next != nullptr) {
+            next->prev = leaf->prev;
+        } else {
+            last_ = leaf->prev;
+        }
+        delete leaf;
+        node_base* removed = leaf;
+        while (removed != nullptr && path.depth > 0) {
+            --path.depth;
+            inner_node* parent = path.nodes[path.depth];
+            size_type slot = path.slots[path.depth];
+            if (parent->count == 0) {
+                delete parent;
+                continue;
+            }
+            size_type key_index = slot > 0 ? slot - 1 : 0;
+            std::move(parent->keys + key_index + 1, parent->keys + parent->count, parent->keys + key_index);
+            std::copy(parent->children + slot + 1, parent->children + parent->count + 1, parent->children + slot);
+            --parent->count;
+            removed = nullptr;
+        }
+        if (removed != nullptr) {
+            root_ = nullptr;
+        }
+        while (root_ != nullptr && !root_->leaf && root_->count == 0) {
+            inner_node* old = static_cast<inner_node*>(root_);
+            root_ = old->children[0];
+            delete old;
+        }
+
+        return leaf_iterator(this, next, 0);
+    }
+
+    void destroy(node_base* node) {
+        if (node->leaf) {
+            delete static_cast<leaf_node*>(node);
+            return;
+        }
+        inner_node* inner = static_cast<inner_node*>(node);
+        for (size_type i = 0; i <= inner->count; ++i) {
+            destroy(inner->children[i]);
+        }
+        delete inner;
+    }
+
+    node_base* clone(const node_base* node, leaf_node*& prev) {
+        if (node->leaf) {
+            const leaf_node* source = static_cast<const leaf_node*>(node);
+            leaf_node* copy = new leaf_node();
+            std::copy(source->keys, source->keys + source->count, copy->keys);
+            copy->count = source->count;
+            copy->prev = prev;
+            if (prev != nullptr) {
+                prev->next = copy;
+            } else {
+                first_ = copy;
+            }
+            prev = copy;
+
+            return copy;
+        }
+        const inner_node* source = static_cast<const inner_node*>(node);
+        inner_node* copy = new inner_node();
+        std::copy(source->keys, source->keys + source->count, copy->keys);
+        for (size_type i = 0; i <= source->count; ++i) {
+            copy->children[i] = clone(source->children[i], prev);
+        }
+        copy->count = source->count;
+
+        return copy;
+    }
+
+    void copy_from(const BPlusTree& other) {
+        if (other.root_ == nullptr) {
+            return;
+        }
+        leaf_node* prev = nullptr;
+        root_ = clone(other.root_, prev);
+        last_ = prev;
+        size_ = other.size_;
+    }
+
+    node_base* root_;
+    leaf_node* first_;
+    leaf_node* last_;
+    size_type size_;
+    [[no_unique_address]] Compare compare_;
+};
@@ -1,53 +1,122 @@
 #pragma once
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BalancePolicy.h"
+#include "BSTImage.h"
+#include "BSTNodePool.h"
+#include "Eytzinger.h"
+#include "ThreadPool.h"
 
 enum class TraverseTag{ In, Pre, Post, };
 
-template<typename T>
-struct Node {
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+inline constexpr sorted_unique_t sorted_unique{};
+
+template<typename Self>
+struct SubtreeSize {
+    size_t count = 1;
+};
+
+// in-order neighbours kept next to the child links, so in-order ++ and -- are one load instead of a climb
+template<typename Self>
+struct InorderLinks {
+    Self* next = nullptr;
+    Self* prev = nullptr;
+};
+
+template<typename T, template<typename> class... Augments>
+struct Node : Augments<Node<T, Augments...> >... {
     T key;
     Node* left;
     Node* right;
     Node* parent;
+    int balance;
 
-    Node() : left(nullptr), right(nullptr), parent(nullptr) {}
+    Node() : left(nullptr), right(nullptr), parent(nullptr), balance(0) {}
+
+    template<typename... Args>
+    explicit Node(std::in_place_t, Args&&... args)
+        : key(std::forward<Args>(args)...), left(nullptr), right(nullptr), parent(nullptr), balance(0) {}
 };
 
-template<typename T, typename Allocator = std::allocator<Node<T> > > 
+template<typename T>
+using CountedNode = Node<T, SubtreeSize>;
+
+template<typename T>
+using ThreadedNode = Node<T, InorderLinks>;
+
+template<typename T, typename Allocator = std::allocator<Node<T> >, typename Balance = NoBalancePolicy,
+         typename Compare = std::less<T> > 
 class BST {
 public:
     typedef T value_type;
     typedef const T const_value_type;
     typedef T key_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
     typedef T& reference;
     typedef const T& const_reference;
     typedef Allocator allocator_type;
+    typedef Balance balance_policy;
     typedef size_t size_type;
     typedef std::ptrdiff_t difference_type;
-    typedef Node<T> node_type;
-    typedef Node<T>* pointer;
+    typedef typename std::allocator_traits<Allocator>::value_type tree_node;
+    typedef tree_node* pointer;
+
+    static_assert(std::is_same_v<decltype(tree_node::key), T>, "Allocator must allocate Node<T, ...>");
+
+    static constexpr bool counted = requires(tree_node& n) { n.count; };
+    static constexpr bool threaded = requires(tree_node& n) { n.next; n.prev; };
 
     template<TraverseTag tag>
     class iterator_base {
     public:
-        typedef std::bidirectional_iterator_tag iterator_category;
+        static constexpr bool ranked = counted && tag == TraverseTag::In;
+
+        typedef std::conditional_t<ranked, std::random_access_iterator_tag, std::bidirectional_iterator_tag> iterator_category;
         typedef std::ptrdiff_t difference_type;
-        typedef TraverseTag value_type;
-        typedef Node<T>* pointer;
-        typedef Node<T>& reference;
-        typedef const Node<T>* const_pointer;
-        typedef const Node<T>& const_reference;
+        typedef T value_type;
+        typedef tree_node* pointer;
+        typedef tree_node& reference;
+        typedef const tree_node* const_pointer;
+        typedef const tree_node& const_reference;
+
+        iterator_base() : ptr_(nullptr), root_() {}
+
+        explicit iterator_base(pointer node) : ptr_(node), root_() {}
 
-        explicit iterator_base(pointer node) : ptr_(node) {}
+        iterator_base(pointer node, const pointer* root) : ptr_(node), root_() {
+            if constexpr (ranked) {
+                root_ = root;
+            }
+        }
 
         iterator_base(const iterator_base& other) {
             ptr_ = other.ptr_;
+            root_ = other.root_;
         }
 
         ~iterator_base() = default;
 
         iterator_base& operator++() {
             if (tag == TraverseTag::In) {
+                if constexpr (threaded) {
+                    ptr_ = ptr_->next;
+                    return *this;
+                }
                 if (ptr_->right != nullptr) {
                     ptr_ = ptr_->right;
                     while (ptr_->left != nullptr) {
@@ -108,7 +177,18 @@ public:
         }
 
         iterator_base& operator--() {
+            if constexpr (ranked) {
+                if (ptr_ == nullptr) {
+                    pointer root = tree_root();
+                    ptr_ = root == nullptr ? nullptr : BST::select(root, root->count - 1);
+                    return *this;
+                }
+            }
             if (tag == TraverseTag::In) {
+                if constexpr (threaded) {
+                    ptr_ = ptr_->prev;
+                    return *this;
+                }
                 if (ptr_->left != nullptr) {
                     ptr_ = ptr_->left;
                     while (ptr_->right != nullptr) {
@@ -177,26 +257,96 @@ public:
         bool operator==(const iterator_base& other) const { return ptr_ == other.ptr_; };
         bool operator!=(const iterator_base& other) const { return ptr_ != other.ptr_; };
 
+        difference_type operator-(const iterator_base& other) const requires ranked {
+            if (ptr_ == other.ptr_) {
+                return 0;
+            }
+            pointer root = ptr_ != nullptr ? BST::root_of(ptr_) : other.tree_root();
+
+            return static_cast<difference_type>(BST::position(root, ptr_))
+                 - static_cast<difference_type>(BST::position(root, other.ptr_));
+        }
+
+        iterator_base& operator+=(difference_type n) requires ranked {
+            if (n != 0) {
+                pointer root = tree_root();
+                ptr_ = BST::select(root, BST::position(root, ptr_) + n);
+            }
+
+            return *this;
+        }
+
+        iterator_base& operator-=(difference_type n) requires ranked { return *this += -n; }
+
+        bool operator<(const iterator_base& other) const requires ranked { return *this - other < 0; }
+        bool operator>(const iterator_base& other) const requires ranked { return *this - other > 0; }
+        bool operator<=(const iterator_base& other) const requires ranked { return *this - other <= 0; }
+        bool operator>=(const iterator_base& other) const requires ranked { return *this - other >= 0; }
+
     protected:
+        friend class BST;
+
+        struct no_root {};
+
+        // end() has no node to climb from, so ranked iterators also remember where their tree keeps its root
+        pointer tree_root() const requires ranked {
+            if (ptr_ != nullptr) {
+                return BST::root_of(ptr_);
+            }
+
+            return root_ != nullptr ? *root_ : nullptr;
+        }
+
         pointer ptr_;
+        [[no_unique_address]] std::conditional_t<ranked, const pointer*, no_root> root_;
     };
 
     template<TraverseTag tag>
     class iterator : public iterator_base<tag> {
     public:
+        using iterator_base<tag>::operator-;
+        iterator() = default;
         explicit iterator(BST::pointer node) : iterator_base<tag>(node) {}
+        iterator(BST::pointer node, const BST::pointer* root) : iterator_base<tag>(node, root) {}
 
-        BST::value_type operator*() { return this->ptr_->key; }
+        iterator& operator++() { iterator_base<tag>::operator++(); return *this; }
+        iterator& operator--() { iterator_base<tag>::operator--(); return *this; }
+        iterator operator++(int) { iterator temp = *this; ++(*this); return temp; }
+        iterator operator--(int) { iterator temp = *this; --(*this); return temp; }
+        iterator& operator+=(difference_type n) requires iterator_base<tag>::ranked { iterator_base<tag>::operator+=(n); return *this; }
+        iterator& operator-=(difference_type n) requires iterator_base<tag>::ranked { iterator_base<tag>::operator-=(n); return *this; }
+
+        BST::const_reference operator*() const { return this->ptr_->key; }
         typename iterator_base<tag>::pointer operator->() { return this->ptr_; }
+
+        iterator operator+(difference_type n) const requires iterator_base<tag>::ranked { iterator temp = *this; temp += n; return temp; }
+        iterator operator-(difference_type n) const requires iterator_base<tag>::ranked { iterator temp = *this; temp -= n; return temp; }
+        BST::const_reference operator[](difference_type n) const requires iterator_base<tag>::ranked { return *(*this + n); }
+        friend iterator operator+(difference_type n, const iterator& it) requires iterator_base<tag>::ranked { return it + n; }
     };
 
     template<TraverseTag tag>
     class const_iterator : public iterator_base<tag> {
     public:
+        using iterator_base<tag>::operator-;
+        const_iterator() = default;
         explicit const_iterator(BST::pointer node) : iterator_base<tag>(node) {}
+        const_iterator(BST::pointer node, const BST::pointer* root) : iterator_base<tag>(node, root) {}
 
-        BST::const_value_type operator*() const { return this->ptr_->key; }
+        const_iterator& operator++() { iterator_base<tag>::operator++(); return *this; }
+        const_iterator& operator--() { iterator_base<tag>::operator--(); return *this; }
+        const_iterator operator++(int) { const_iterator temp = *this; ++(*this); return temp; }
+        const_iterator operator--(int) { const_iterator temp = *this; --(*this); return temp; }
+        const_iterator& operator+=(difference_type n) requires iterator_base<tag>::ranked { iterator_base<tag>::operator+=(n); return *this; }
+        const_iterator& operator-=(difference_type n) requires iterator_base<tag>::ranked { iterator_base<tag>::operator-=(n); return *this; }
+
+        BST::const_reference operator*() const { return this->ptr_->key; }
         typename iterator_base<tag>::const_pointer operator->() const { return this->ptr_; }
+
+        const_iterator operator+(difference_type n) const requires iterator_base<tag>::ranked { const_iterator temp = *this; temp += n; return temp; }
+        const_iterator operator-(difference_type n) const requires iterator_base<tag>::ranked { const_iterator temp = *this; temp -= n; return temp; }
+        BST::const_reference operator[](difference_type n) const requires iterator_base<tag>::ranked { return *(*this + n); }
+        friend const_iterator operator+(difference_type n, const const_iterator& it) requires iterator_base<tag>::ranked { return it + n; }
     };
 
     template<TraverseTag tag>
@@ -204,6 +354,7 @@ public:
     public:
         using iterator_base<tag>::operator--;
         explicit reverse_iterator(BST::pointer node) : iterator_base<tag>(node) {}
+        reverse_iterator(BST::pointer node, const BST::pointer* root) : iterator_base<tag>(node, root) {}
 
         reverse_iterator& operator++() {
             this->operator--();
@@ -212,7 +363,7 @@ public:
         reverse_iterator operator++(int) { reverse_iterator temp = *this; --(*this); return temp; }
         reverse_iterator operator--(int) { reverse_iterator temp = *this; ++(*this); return temp; }
 
-        BST::value_type operator*() { return this->ptr_->key; }
+        BST::const_reference operator*() const { return this->ptr_->key; }
         typename iterator_base<tag>::pointer operator->() { return this->ptr_; }
     };
 
@@ -221,6 +372,7 @@ public:
     public:
         using iterator_base<tag>::operator--;
         explicit const_reverse_iterator(BST::pointer node) : iterator_base<tag>(node) {}
+        const_reverse_iterator(BST::pointer node, const BST::pointer* root) : iterator_base<tag>(node, root) {}
 
         const_reverse_iterator& operator++() {
             this->operator--();
@@ -229,43 +381,148 @@ public:
         const_reverse_iterator operator++(int) { const_reverse_iterator temp = *this; --(*this); return temp; }
         const_reverse_iterator operator--(int) { const_reverse_iterator temp = *this; ++(*this); return temp; }
 
-        BST::const_value_type operator*() const { return this->ptr_->key; }
+        BST::const_reference operator*() const { return this->ptr_->key; }
         typename iterator_base<tag>::const_pointer operator->() const { return this->ptr_; }
     };
 
+    class node_type {
+    public:
+        typedef T value_type;
+        typedef Allocator allocator_type;
+
+        node_type() noexcept = default;
+
+        node_type(node_type&& other) noexcept : ptr_(other.ptr_), allocator_(std::move(other.allocator_)) {
+            other.ptr_ = nullptr;
+            other.allocator_.reset();
+        }
+
+        node_type& operator=(node_type&& other) noexcept {
+            if (this != &other) {
+                reset();
+                ptr_ = other.ptr_;
+                allocator_ = std::move(other.allocator_);
+                other.ptr_ = nullptr;
+                other.allocator_.reset();
+            }
+
+            return *this;
+        }
+
+        ~node_type() { reset(); }
+
+        bool empty() const noexcept { return ptr_ == nullptr; }
+        explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+        value_type& value() const { return ptr_->key; }
+        allocator_type get_allocator() const { return *allocator_; }
+
+        void swap(node_type& other) noexcept {
+            std::swap(ptr_, other.ptr_);
+            std::swap(allocator_, other.allocator_);
+        }
+
+    private:
+        friend class BST;
+
+        node_type(pointer node, const allocator_type& allocator) : ptr_(node), allocator_(allocator) {}
+
+        pointer release() {
+            pointer node = ptr_;
+            ptr_ = nullptr;
+            allocator_.reset();
+
+            return node;
+        }
+
+        void reset() {
+            if (ptr_ != nullptr) {
+                std::allocator_traits<Allocator>::destroy(*allocator_, ptr_);
+                std::allocator_traits<Allocator>::deallocate(*allocator_, ptr_, 1);
+                ptr_ = nullptr;
+            }
+            allocator_.reset();
+        }
+
+        pointer ptr_ = nullptr;
+        std::optional<allocator_type> allocator_;
+    };
+
+    struct insert_return_type {
+        iterator<TraverseTag::In> position;
+        bool inserted;
+        node_type node;
+    };
+
 public:
-    BST() : root_(nullptr), size_(0), allocator_(Allocator()) {}
+    BST() : header_(), size_(0), allocator_(Allocator()), compare_() {}
+
+    explicit BST(const Compare& compare, const Allocator& allocator = Allocator())
+        : header_(), size_(0), allocator_(allocator), compare_(compare) {}
 
     BST (const BST& other) 
-        : root_(nullptr), size_(0), allocator_(other.allocator_) {
-            if (other.root_ != nullptr) {
-                root_ = Copy(nullptr, other.root_);
-            }
+        : header_(), size_(0),
+          allocator_(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.allocator_)),
+          compare_(other.compare_) {
+            copy_from(other);
+        }
+
+    BST(BST&& other) noexcept
+        : header_(other.header_), size_(other.size_), allocator_(std::move(other.allocator_)),
+          compare_(std::move(other.compare_)) {
+            other.header_ = header_type();
+            other.size_ = 0;
         }
 
     template<typename InputIt>
     BST(InputIt i, InputIt j, const Allocator& allocator = Allocator()) 
-        : root_(nullptr), size_(0), allocator_(allocator) {
-            for (; i != j; ++i) {
-                insert(i);
-            }
+        : header_(), size_(0), allocator_(allocator), compare_() {
+            insert(i, j);
+        }
+
+    template<typename InputIt>
+    BST(sorted_unique_t, InputIt i, InputIt j, const Allocator& allocator = Allocator())
+        : header_(), size_(0), allocator_(allocator), compare_() {
+            assign_sorted(i, j);
         }
 
     BST(std::initializer_list<value_type> il, const Allocator& allocator = Allocator()) 
-        : root_(nullptr), size_(0), allocator_(allocator) {
+        : header_(), size_(0), allocator_(allocator), compare_() {
             insert(il);
         }
 
-    ~BST() { clear(); }
+    // never hands work to the thread pool, which a static tree may outlive
+    ~BST() { destroy_nodes(false); }
 
     BST& operator=(const BST& other) {
         if (this == &other) {
             return *this;
         }
         clear();
-        if (other.root_ != nullptr) {
-            root_ = Copy(nullptr, other.root_);
+        copy_from(other);
+
+        return *this;
+    }
+
+    BST& operator=(BST&& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value
+                                         || std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value) {
+        if (this == &other) {
+            return *this;
+        }
+        clear();
+        if constexpr (std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value) {
+            allocator_ = std::move(other.allocator_);
+        } else if (allocator_ != other.allocator_) {
+            copy_from(other);
+            other.clear();
+
+            return *this;
         }
+        header_ = other.header_;
+        size_ = other.size_;
+        compare_ = std::move(other.compare_);
+        other.header_ = header_type();
+        other.size_ = 0;
 
         return *this;
     }
@@ -286,7 +543,7 @@ public:
         auto other_it = other.cbegin<TraverseTag::Pre>();
         auto other_end = other.cend<TraverseTag::Pre>();
         while (this_it != this_end && other_it != this_end) {
-            if (*this_it != *other_it) {
+            if (compare_(*this_it, *other_it) || compare_(*other_it, *this_it)) {
                 return false;
             }
             ++this_it;
@@ -302,200 +559,114 @@ public:
     bool operator!=(const BST& other) const { return !(*this == other); }
 
     void swap(BST& other) {
-        std::swap(this->root_, other.root_);
+        std::swap(this->header_, other.header_);
         std::swap(this->size_, other.size_);
+        std::swap(this->allocator_, other.allocator_);
+        std::swap(this->compare_, other.compare_);
     }
 
     void swap(BST& a, BST& b) { a.swap(b); }
 
-    size_t size() const {
-        return std::distance(this->cbegin<TraverseTag::In>(), this->cend<TraverseTag::In>());
-    }
+    size_t size() const { return size_; }
 
     size_t max_size() const { return std::numeric_limits<difference_type>::max(); }
 
-    bool empty() const {
-        return this->cbegin<TraverseTag::In>() == this->cend<TraverseTag::In>();
-    }
+    allocator_type get_allocator() const { return allocator_; }
 
-    template<TraverseTag tag>
-    iterator<tag> begin() {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr && temp->left != nullptr) {
-                temp = temp->left;
-            }
-        } else if (tag == TraverseTag::Post) {
-            while (temp != nullptr && (temp->left != nullptr || temp->right != nullptr)) {
-                if (temp->left != nullptr) {
-                    temp = temp->left;
-                } else {
-                    temp = temp->right;
-                }
-            }
-        }
+    key_compare key_comp() const { return compare_; }
 
-        return iterator<tag>(temp);
-    }
+    value_compare value_comp() const { return compare_; }
 
-    template<TraverseTag tag>
-    iterator<tag> end() {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr) {
-                temp = temp->right;
-            }
-        } else if (tag == TraverseTag::Pre) {
-            while (temp != nullptr) {
-                temp = temp->right;
-            }
-        } else {
-            temp = nullptr;
-        }
+    bool empty() const { return size_ == 0; }
 
-        return iterator<tag>(temp);
-    }
+    class range_view {
+    public:
+        range_view(const_iterator<TraverseTag::In> first, const_iterator<TraverseTag::In> last)
+            : first_(first), last_(last) {}
 
-    template<TraverseTag tag>
-    const_iterator<tag> cbegin() const {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr && temp->left != nullptr) {
-                temp = temp->left;
-            }
-        } else if (tag == TraverseTag::Post) {
-            while (temp != nullptr && (temp->left != nullptr || temp->right != nullptr)) {
-                if (temp->left != nullptr) {
-                    temp = temp->left;
-                } else {
-                    temp = temp->right;
-                }
-            }
-        }
+        const_iterator<TraverseTag::In> begin() const { return first_; }
+        const_iterator<TraverseTag::In> end() const { return last_; }
+        bool empty() const { return first_ == last_; }
 
-        return const_iterator<tag>(temp);
-    }
+    private:
+        const_iterator<TraverseTag::In> first_;
+        const_iterator<TraverseTag::In> last_;
+    };
 
     template<TraverseTag tag>
-    const_iterator<tag> cend() const {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr) {
-                temp = temp->right;
-            }
-        } else if (tag == TraverseTag::Pre) {
-            while (temp != nullptr) {
-                temp = temp->right;
-            }
-        } else {
-            temp = nullptr;
-        }
+    iterator<tag> begin() { return iterator<tag>(first_node<tag>(), &header_.root); }
 
-        return const_iterator<tag>(temp);
-    }
+    template<TraverseTag tag>
+    iterator<tag> end() { return iterator<tag>(nullptr, &header_.root); }
 
     template<TraverseTag tag>
-    reverse_iterator<tag> rbegin() {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr && temp->right != nullptr) {
-                temp = temp->right;
-            }
-        } else if (tag == TraverseTag::Pre) {
-            while (temp->right != nullptr || temp->left != nullptr) {
-                if (temp->right != nullptr) {
-                    temp = temp->right;
-                } else {
-                    temp = temp->left;
-                }
-            }
-        }
+    const_iterator<tag> cbegin() const { return const_iterator<tag>(first_node<tag>(), &header_.root); }
 
-        return reverse_iterator<tag>(temp);
-    }
+    template<TraverseTag tag>
+    const_iterator<tag> cend() const { return const_iterator<tag>(nullptr, &header_.root); }
 
     template<TraverseTag tag>
-    reverse_iterator<tag> rend() {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr) {
-                temp = temp->left;
-            }
-        } else if (tag == TraverseTag::Post) {
-            while (temp != nullptr) {
-                temp = temp->left;
-            }
-        }
+    reverse_iterator<tag> rbegin() { return reverse_iterator<tag>(last_node<tag>(), &header_.root); }
 
-        return reverse_iterator<tag>(temp);
+    template<TraverseTag tag>
+    reverse_iterator<tag> rend() {
+        return reverse_iterator<tag>(tag == TraverseTag::Pre ? header_.root : nullptr, &header_.root);
     }
 
     template<TraverseTag tag>
-    const_reverse_iterator<tag> crbegin() const {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr && temp->right != nullptr) {
-                temp = temp->right;
-            }
-        } else if (tag == TraverseTag::Pre) {
-            while (temp->right != nullptr || temp->left != nullptr) {
-                if (temp->right != nullptr) {
-                    temp = temp->right;
-                } else {
-                    temp = temp->left;
-                }
-            }
-        }
-
-        return const_reverse_iterator<tag>(temp);
-    }
+    const_reverse_iterator<tag> crbegin() const { return const_reverse_iterator<tag>(last_node<tag>(), &header_.root); }
 
     template<TraverseTag tag>
     const_reverse_iterator<tag> crend() const {
-        pointer temp = root_;
-        if (tag == TraverseTag::In) {
-            while (temp != nullptr) {
-                temp = temp->left;
-            }
-        } else if (tag == TraverseTag::Post) {
-            while (temp != nullptr) {
-                temp = temp->left;
-            }
-        }
+        return const_reverse_iterator<tag>(tag == TraverseTag::Pre ? header_.root : nullptr, &header_.root);
+    }
+
+    void clear() { destroy_nodes(true); }
+
+    std::pair<iterator<TraverseTag::In>, bool> insert_check(const value_type& value) {
+        std::pair<pointer, bool> result = insert_node(value);
 
-        return const_reverse_iterator<tag>(temp);
+        return {iterator<TraverseTag::In>(result.first, &header_.root), result.second};
     }
 
-    void clear() {
-        deep_clear(root_);
-        root_ = nullptr;
-        size_ = 0;
+    iterator<TraverseTag::In> insert(const value_type& value) {
+        return iterator<TraverseTag::In>(insert_node(value).first, &header_.root);
     }
 
-    std::pair<iterator<TraverseTag::In>, bool> insert_check(const value_type& value) {
-        pointer temp = exist_node(root_, value);
-        if (temp != nullptr) {
-            return {iterator<TraverseTag::In>(temp), false};
-        } else {
-            root_ = insert_node(root_, nullptr, value);
-            temp = exist_node(root_, value);
-            ++size_;
+    iterator<TraverseTag::In> insert(value_type&& value) {
+        return iterator<TraverseTag::In>(insert_node(std::move(value)).first, &header_.root);
+    }
+
+    template<typename... Args>
+    std::pair<iterator<TraverseTag::In>, bool> emplace(Args&&... args) {
+        pointer temp = create_node(std::forward<Args>(args)...);
+        pointer parent;
+        bool left;
+        pointer found = find_slot(temp->key, parent, left);
+        if (found != nullptr) {
+            destroy_node(temp);
 
-            return {iterator<TraverseTag::In>(temp), true};
+            return {iterator<TraverseTag::In>(found, &header_.root), false};
         }
+        link_node(temp, parent, left);
+
+        return {iterator<TraverseTag::In>(temp, &header_.root), true};
     }
 
-    iterator<TraverseTag::In> insert(const value_type& value) {
-        pointer temp = exist_node(root_, value);
-        if (temp != nullptr) {
-            return iterator<TraverseTag::In>(temp);
-        } else {
-            root_ = insert_node(root_, nullptr, value);
-            temp = exist_node(root_, value);
-            ++size_;
+    template<typename... Args>
+    iterator<TraverseTag::In> emplace_hint(const iterator_base<TraverseTag::In>& hint, Args&&... args) {
+        pointer temp = create_node(std::forward<Args>(args)...);
+        pointer parent;
+        bool left;
+        pointer found = hint_slot(hint.ptr_, temp->key, parent, left);
+        if (found != nullptr) {
+            destroy_node(temp);
 
-            return iterator<TraverseTag::In>(temp);
+            return iterator<TraverseTag::In>(found, &header_.root);
         }
+        link_node(temp, parent, left);
+
+        return iterator<TraverseTag::In>(temp, &header_.root);
     }
 
     void insert(std::initializer_list<value_type> il) {
@@ -507,280 +678,1350 @@ public:
     template<class InputIt>
     void insert(InputIt i, InputIt j) {
         for (; i != j; ++i) {
-            insert(i);
+            insert(range_value(i));
         }
     }
 
-    node_type extract(const value_type& value) {
-        pointer temp = exist_node(root_, value);
-        if (temp == nullptr) {
-            return Node<T>();
-        }
-        node_type extracted;
-        extracted.key = temp->key;
-        extracted.left = nullptr;
-        extracted.right = nullptr;
-        extracted.parent = nullptr;
-        delete_node(root_, value);
-        --size_;
-
-        return extracted;
+    // [i, j) must be strictly increasing under key_comp()
+    template<class InputIt>
+    void assign_sorted(InputIt i, InputIt j) {
+        clear();
+        pointer head = nullptr;
+        pointer tail = nullptr;
+        size_type count = 0;
+        try {
+            for (; i != j; ++i) {
+                append_node(head, tail, create_node(range_value(i)));
+                ++count;
+            }
+        } catch (...) {
+            destroy_list(head);
+            throw;
+        }
+        build_from_list(head, tail, count);
     }
 
-    void merge(BST& other) {
-        if (this->allocator_ != other.allocator_) {
-            std::cerr << "..error";
+    insert_return_type insert(node_type&& handle) {
+        if (handle.empty()) {
+            return {end<TraverseTag::In>(), false, node_type()};
+        }
+        if (allocator_ != *handle.allocator_) {
+            std::cerr << "..error: node handle belongs to a different allocator";
             std::exit(EXIT_FAILURE);
         }
-        for (auto it = other.begin<TraverseTag::In>(); it != other.end<TraverseTag::In>(); ++it) {
-            auto result = this->insert(*it);
+        pointer parent;
+        bool left;
+        pointer found = find_slot(handle.value(), parent, left);
+        if (found != nullptr) {
+            return {iterator<TraverseTag::In>(found, &header_.root), false, std::move(handle)};
         }
-        other.clear();
-    }
+        pointer temp = handle.release();
+        temp->left = nullptr;
+        temp->right = nullptr;
+        link_node(temp, parent, left);
 
-    size_type erase(const value_type& value) {
-        if (exist_node(root_, value) != nullptr) {
-            delete_node(root_, value);
-            --size_;
+        return {iterator<TraverseTag::In>(temp, &header_.root), true, node_type()};
+    }
 
-            return 1;
+    node_type extract(const value_type& value) {
+        pointer temp = exist_node(header_.root, value);
+        if (temp == nullptr) {
+            return node_type();
         }
+        unlink_node(temp);
 
-        return 0;
+        return node_type(temp, allocator_);
     }
 
-    template<TraverseTag tag>
-    iterator<tag> erase(iterator<tag> q) {
-        if (q == end<tag>()) {
-            return end<tag>();
-        }
-        value_type value = *q;
-        iterator<tag> next = q;
-        if (tag != TraverseTag::In) {
-            ++next;
-            delete_node(root_, value);
-            --size_;
-        } else {
-            delete_node(root_, value);
-            --size_;
-            next = iterator<tag>(next_node(root_, value));
+    node_type extract(const iterator_base<TraverseTag::In>& position) {
+        if (position.ptr_ == nullptr) {
+            return node_type();
         }
+        unlink_node(position.ptr_);
 
-        return next;
+        return node_type(position.ptr_, allocator_);
     }
 
-    template<TraverseTag tag>
-    const_iterator<tag> erase(const_iterator<tag> r) {
-        if (r == cend<tag>()) {
-            return cend<tag>();
+    void merge(BST& other) {
+        if (this->allocator_ != other.allocator_) {
+            std::cerr << "..error";
+            std::exit(EXIT_FAILURE);
         }
-        value_type value = *r;
-        const_iterator<tag> next = r;
-        if (tag != TraverseTag::In) {
-            ++next;
-            delete_node(root_, value);
-            --size_;
-        } else {
-            delete_node(root_, value);
-            --size_;
-            next = const_iterator<tag>(next_node(root_, value));
+        if (this == &other) {
+            return;
         }
-
-        return next;
-    }
-
-    iterator<TraverseTag::In> find(const value_type& k) {
-        pointer temp = exist_node(root_, k);
-        if (temp == nullptr) {
-            return end<TraverseTag::In>();
+        pointer temp = other.release_list();
+        while (temp != nullptr) {
+            pointer next = temp->right;
+            pointer parent;
+            bool left;
+            if (find_slot(temp->key, parent, left) != nullptr) {
+                destroy_node(temp);
+            } else {
+                temp->left = nullptr;
+                temp->right = nullptr;
+                link_node(temp, parent, left);
+            }
+            temp = next;
         }
-        
-        return iterator<TraverseTag::In>(temp);
     }
 
-    const_iterator<TraverseTag::In> find(const value_type& k) const {
-        pointer temp = exist_node(root_, k);
-        if (temp == nullptr) {
-            return cend<TraverseTag::In>();
+    void set_union(BST& other) {
+        if (this == &other) {
+            return;
         }
-        
-        return const_iterator<TraverseTag::In>(temp);
-    }
+        if (allocator_ != other.allocator_) {
+            BST temp(compare_, allocator_);
+            temp.assign_sorted(other.cbegin<TraverseTag::In>(), other.cend<TraverseTag::In>());
+            other.clear();
+            set_union(temp);
 
-    iterator<TraverseTag::In> lower_bound(const value_type& k) {
-        if (exist_node(root_, k) == nullptr) {
-            return end<TraverseTag::In>();
+            return;
         }
-        pointer temp = prev_node(root_, k);
-        if (temp == nullptr) {
-            return end<TraverseTag::In>();
+        pointer head = nullptr;
+        pointer tail = nullptr;
+        size_type count = 0;
+        pointer a = release_list();
+        pointer b = other.release_list();
+        while (a != nullptr || b != nullptr) {
+            pointer next;
+            if (b == nullptr || (a != nullptr && compare_(a->key, b->key))) {
+                next = a->right;
+                append_node(head, tail, a);
+                a = next;
+            } else if (a == nullptr || compare_(b->key, a->key)) {
+                next = b->right;
+                append_node(head, tail, b);
+                b = next;
+            } else {
+                next = b->right;
+                other.destroy_node(b);
+                b = next;
+                continue;
+            }
+            ++count;
         }
-        
-        return iterator<TraverseTag::In>(temp);
+        build_from_list(head, tail, count);
     }
 
-    const_iterator<TraverseTag::In> lower_bound(const value_type& k) const {
-        if (exist_node(root_, k) == nullptr) {
-            return end<TraverseTag::In>();
-        }
-        pointer temp = prev_node(root_, k);
-        if (temp == nullptr) {
-            return cend<TraverseTag::In>();
+    void set_intersection(const BST& other) {
+        if (this != &other) {
+            filter_sorted(other, true);
         }
-        
-        return const_iterator<TraverseTag::In>(temp);
     }
 
-    iterator<TraverseTag::In> upper_bound(const value_type& k) {
-        if (exist_node(root_, k) == nullptr) {
-            return end<TraverseTag::In>();
+    void set_difference(const BST& other) {
+        if (this == &other) {
+            clear();
+        } else {
+            filter_sorted(other, false);
         }
-        pointer temp = next_node(root_, k);
-        if (temp == nullptr) {
-            return end<TraverseTag::In>();
+    }
+
+    friend BST set_union(const BST& lhs, const BST& rhs) {
+        BST result(lhs.compare_, std::allocator_traits<Allocator>::select_on_container_copy_construction(lhs.allocator_));
+        result.assign_merged(lhs, rhs, true, true, true);
+
+        return result;
+    }
+
+    friend BST set_intersection(const BST& lhs, const BST& rhs) {
+        BST result(lhs.compare_, std::allocator_traits<Allocator>::select_on_container_copy_construction(lhs.allocator_));
+        result.assign_merged(lhs, rhs, false, true, false);
+
+        return result;
+    }
+
+    friend BST set_difference(const BST& lhs, const BST& rhs) {
+        BST result(lhs.compare_, std::allocator_traits<Allocator>::select_on_container_copy_construction(lhs.allocator_));
+        result.assign_merged(lhs, rhs, true, false, false);
+
+        return result;
+    }
+
+    // relinking the search path is O(log n) for balanced policies, but only counted nodes (SubtreeSize) read
+    // the new sizes off the roots; other nodes step through the smaller half, O(min(k, n - k)) for k keys
+    // kept, so a split near the median is O(n)
+    BST split(const value_type& key) {
+        BST result(compare_, allocator_);
+        pointer last = nullptr;
+        bool last_lower = false;
+        int rank = Balance::rank(header_.root);
+        for (pointer temp = header_.root; temp != nullptr;) {
+            last = temp;
+            last_lower = compare_(temp->key, key);
+            pointer next = last_lower ? temp->right : temp->left;
+            int next_rank = Balance::child_rank(temp, rank, next);
+            // the path node is re-linked as a join pivot, so its balance field holds the rank of the subtree it keeps
+            temp->balance = Balance::child_rank(temp, rank, last_lower ? temp->left : temp->right);
+            rank = next_rank;
+            temp = next;
         }
-        
-        return iterator<TraverseTag::In>(temp);
+        pointer lower = nullptr;
+        pointer upper = nullptr;
+        int lower_rank = 0;
+        int upper_rank = 0;
+        bool is_lower = last_lower;
+        for (pointer temp = last; temp != nullptr;) {
+            pointer parent = temp->parent;
+            bool parent_lower = parent != nullptr && temp == parent->right;
+            pointer subtree = is_lower ? temp->left : temp->right;
+            if (subtree != nullptr) {
+                subtree->parent = nullptr;
+            }
+            temp->left = nullptr;
+            temp->right = nullptr;
+            temp->parent = nullptr;
+            if (is_lower) {
+                lower = Balance::join(subtree, temp->balance, temp, lower, lower_rank, lower_rank);
+            } else {
+                upper = Balance::join(upper, upper_rank, temp, subtree, temp->balance, upper_rank);
+            }
+            temp = parent;
+            is_lower = parent_lower;
+        }
+        if constexpr (threaded) {
+            if (lower != nullptr) {
+                maximum_node(lower)->next = nullptr;
+            }
+            if (upper != nullptr) {
+                minimum_node(upper)->prev = nullptr;
+            }
+        }
+        size_type total = size_;
+        size_type lower_size = lower_count(lower, upper, total);
+        set_root(lower, lower_size);
+        result.set_root(upper, total - lower_size);
+
+        return result;
     }
 
-    const_iterator<TraverseTag::In> upper_bound(const value_type& k) const {
-        if (exist_node(root_, k) == nullptr) {
-            return end<TraverseTag::In>();
+    void join(BST& other) {
+        if (this == &other || other.header_.root == nullptr) {
+            return;
         }
-        pointer temp = next_node(root_, k);
-        if (temp == nullptr) {
-            return cend<TraverseTag::In>();
+        if (allocator_ != other.allocator_
+            || (header_.root != nullptr && !compare_(header_.rightmost->key, other.header_.leftmost->key))) {
+            std::cerr << "..error";
+            std::exit(EXIT_FAILURE);
+        }
+        pointer pivot = other.header_.leftmost;
+        other.unlink_node(pivot);
+        pivot->left = nullptr;
+        pivot->right = nullptr;
+        pivot->parent = nullptr;
+        if constexpr (threaded) {
+            thread_between(pivot, header_.rightmost, other.header_.leftmost);
+        }
+        int rank;
+        pointer root = Balance::join(header_.root, Balance::rank(header_.root), pivot,
+                                     other.header_.root, Balance::rank(other.header_.root), rank);
+        set_root(root, size_ + other.size_ + 1);
+        other.header_ = header_type();
+        other.size_ = 0;
+    }
+
+    friend BST join(BST&& lhs, BST&& rhs) {
+        lhs.join(rhs);
+
+        return std::move(lhs);
+    }
+
+    size_type erase(const value_type& value) {
+        pointer temp = exist_node(header_.root, value);
+        if (temp != nullptr) {
+            delete_node(temp);
+
+            return 1;
+        }
+
+        return 0;
+    }
+
+    template<TraverseTag tag>
+    iterator<tag> erase(iterator<tag> q) {
+        if (q == end<tag>()) {
+            return end<tag>();
+        }
+        iterator<tag> next = q;
+        ++next;
+        delete_node(q.ptr_);
+
+        return next;
+    }
+
+    template<TraverseTag tag>
+    const_iterator<tag> erase(const_iterator<tag> r) {
+        if (r == cend<tag>()) {
+            return cend<tag>();
+        }
+        const_iterator<tag> next = r;
+        ++next;
+        delete_node(r.ptr_);
+
+        return next;
+    }
+
+    iterator<TraverseTag::In> nth(size_type k) requires counted {
+        return iterator<TraverseTag::In>(select(header_.root, k), &header_.root);
+    }
+
+    const_iterator<TraverseTag::In> nth(size_type k) const requires counted {
+        return const_iterator<TraverseTag::In>(select(header_.root, k), &header_.root);
+    }
+
+    size_type rank(const value_type& k) const requires counted {
+        size_type result = 0;
+        pointer temp = header_.root;
+        while (temp != nullptr) {
+            if (compare_(temp->key, k)) {
+                result += subtree_count(temp->left) + 1;
+                temp = temp->right;
+            } else {
+                temp = temp->left;
+            }
+        }
+
+        return result;
+    }
+
+    size_type count_range(const value_type& lo, const value_type& hi) const requires counted {
+        if (!compare_(lo, hi)) {
+            return 0;
+        }
+
+        return rank(hi) - rank(lo);
+    }
+
+    iterator<TraverseTag::In> find(const value_type& k) {
+        return iterator<TraverseTag::In>(exist_node(header_.root, k), &header_.root);
+    }
+
+    const_iterator<TraverseTag::In> find(const value_type& k) const {
+        return const_iterator<TraverseTag::In>(exist_node(header_.root, k), &header_.root);
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator<TraverseTag::In> find(const K& k) {
+        return iterator<TraverseTag::In>(exist_node(header_.root, k), &header_.root);
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const_iterator<TraverseTag::In> find(const K& k) const {
+        return const_iterator<TraverseTag::In>(exist_node(header_.root, k), &header_.root);
+    }
+
+    void find_batch(std::span<const value_type> keys, std::span<iterator<TraverseTag::In> > out) {
+        check_batch(keys.size(), out.size());
+        descend_batch(keys, [&](size_type i, pointer found) {
+            out[i] = iterator<TraverseTag::In>(found, &header_.root);
+        });
+    }
+
+    void find_batch(std::span<const value_type> keys, std::span<const_iterator<TraverseTag::In> > out) const {
+        check_batch(keys.size(), out.size());
+        descend_batch(keys, [&](size_type i, pointer found) {
+            out[i] = const_iterator<TraverseTag::In>(found, &header_.root);
+        });
+    }
+
+    void contains_batch(std::span<const value_type> keys, std::span<bool> out) const {
+        check_batch(keys.size(), out.size());
+        descend_batch(keys, [&](size_type i, pointer found) { out[i] = found != nullptr; });
+    }
+
+    std::pair<iterator<TraverseTag::In>, iterator<TraverseTag::In> > equal_range(const value_type& k) {
+        std::pair<pointer, pointer> nodes = equal_nodes(k);
+
+        return {iterator<TraverseTag::In>(nodes.first, &header_.root),
+                iterator<TraverseTag::In>(nodes.second, &header_.root)};
+    }
+
+    std::pair<const_iterator<TraverseTag::In>, const_iterator<TraverseTag::In> > equal_range(const value_type& k) const {
+        std::pair<pointer, pointer> nodes = equal_nodes(k);
+
+        return {const_iterator<TraverseTag::In>(nodes.first, &header_.root),
+                const_iterator<TraverseTag::In>(nodes.second, &header_.root)};
+    }
+
+    template<typename Function>
+    void for_each_in_range(const value_type& lo, const value_type& hi, Function f) const {
+        for (pointer temp = first_not_less(lo); temp != nullptr && compare_(temp->key, hi);) {
+            f(static_cast<const_reference>(temp->key));
+            const_iterator<TraverseTag::In> next(temp);
+            ++next;
+            temp = next.ptr_;
         }
-        
-        return const_iterator<TraverseTag::In>(temp);
     }
-    
+
+    // f runs concurrently on disjoint subtrees, so it must be safe to call from several threads at once
+    template<TraverseTag tag = TraverseTag::In, typename Function>
+    void parallel_for_each(Function f) const {
+        if (header_.root == nullptr) {
+            return;
+        }
+        if (size_ < parallel_cutoff) {
+            visit_subtree<tag>(header_.root, f);
+            return;
+        }
+        parallel_visit<tag>(header_.root, parallel_depth(), f);
+    }
+
+    range_view range(const value_type& lo, const value_type& hi) const {
+        if (!compare_(lo, hi)) {
+            return range_view(cend<TraverseTag::In>(), cend<TraverseTag::In>());
+        }
+
+        return range_view(const_iterator<TraverseTag::In>(first_not_less(lo), &header_.root),
+                          const_iterator<TraverseTag::In>(first_not_less(hi), &header_.root));
+    }
+
+    // writes the image MappedBST<T, Compare>::open maps back; false if the file could not be written
+    bool save(const std::string& path) const requires std::is_trivially_copyable_v<T> {
+        std::vector<char> keys(size_ * sizeof(T));
+        size_type k = Eytzinger::first(size_);
+        for (auto it = cbegin<TraverseTag::In>(); it != cend<TraverseTag::In>(); ++it) {
+            std::memcpy(keys.data() + (k - 1) * sizeof(T), &*it, sizeof(T));
+            k = Eytzinger::next(k, size_);
+        }
+        BSTImageHeader header = BSTImageHeader::make<T>(size_, BSTImageHeader::checksum_of(keys.data(), keys.size()));
+        char padding[BSTImageHeader::keys_offset - sizeof(BSTImageHeader)] = {};
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(padding, sizeof(padding));
+        out.write(keys.data(), static_cast<std::streamsize>(keys.size()));
+        out.close();
+
+        return !out.fail();
+    }
+
+    iterator<TraverseTag::In> lower_bound(const value_type& k) {
+        return iterator<TraverseTag::In>(lower_node(k), &header_.root);
+    }
+
+    const_iterator<TraverseTag::In> lower_bound(const value_type& k) const {
+        return const_iterator<TraverseTag::In>(lower_node(k), &header_.root);
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator<TraverseTag::In> lower_bound(const K& k) {
+        return iterator<TraverseTag::In>(lower_node(k), &header_.root);
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const_iterator<TraverseTag::In> lower_bound(const K& k) const {
+        return const_iterator<TraverseTag::In>(lower_node(k), &header_.root);
+    }
+
+    iterator<TraverseTag::In> upper_bound(const value_type& k) {
+        return iterator<TraverseTag::In>(upper_node(k), &header_.root);
+    }
+
+    const_iterator<TraverseTag::In> upper_bound(const value_type& k) const {
+        return const_iterator<TraverseTag::In>(upper_node(k), &header_.root);
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator<TraverseTag::In> upper_bound(const K& k) {
+        return iterator<TraverseTag::In>(upper_node(k), &header_.root);
+    }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const_iterator<TraverseTag::In> upper_bound(const K& k) const {
+        return const_iterator<TraverseTag::In>(upper_node(k), &header_.root);
+    }
+
 private:
+    static constexpr size_type batch_group = 16;
+    static constexpr size_type parallel_cutoff = 1 << 15;
+    // nodes are created and destroyed from pool threads, which a stateful allocator may not expect
+    static constexpr bool parallel_allocator = std::allocator_traits<Allocator>::is_always_equal::value;
+
+    struct header_type {
+        pointer root = nullptr;
+        pointer leftmost = nullptr;
+        pointer rightmost = nullptr;
+        mutable pointer post_first = nullptr;
+        mutable pointer pre_last = nullptr;
+    };
 
-    pointer root_;
+    header_type header_;
     size_t size_;
     allocator_type allocator_;
+    [[no_unique_address]] key_compare compare_;
+
+    pointer Copy(pointer source) {
+        pointer root = clone_node(source, nullptr);
+        pointer from = source;
+        pointer to = root;
+        try {
+            while (true) {
+                if (from->left != nullptr && to->left == nullptr) {
+                    to->left = clone_node(from->left, to);
+                    from = from->left;
+                    to = to->left;
+                } else if (from->right != nullptr && to->right == nullptr) {
+                    to->right = clone_node(from->right, to);
+                    from = from->right;
+                    to = to->right;
+                } else if (from != source) {
+                    from = from->parent;
+                    to = to->parent;
+                } else {
+                    break;
+                }
+            }
+        } catch (...) {
+            deep_clear(root);
+            throw;
+        }
 
-    pointer Copy(pointer par, pointer cur) {
-        if (cur == nullptr) {
-            return nullptr;
+        return root;
+    }
+
+    pointer parallel_copy(pointer source, int depth) {
+        if (depth == 0) {
+            return Copy(source);
         }
-        pointer new_node = allocator_.allocate(1);
-        new_node->key = cur->key;
-        new_node->parent = par;
+        pointer root = clone_node(source, nullptr);
+        pointer left = nullptr;
+        pointer right = nullptr;
+        // a half that threw has already freed its own nodes, so only the finished half and root are left
+        try {
+            ThreadPool::instance().invoke(
+                [&] {
+                    if (source->left != nullptr) {
+                        left = parallel_copy(source->left, depth - 1);
+                    }
+                },
+                [&] {
+                    if (source->right != nullptr) {
+                        right = parallel_copy(source->right, depth - 1);
+                    }
+                });
+        } catch (...) {
+            deep_clear(left);
+            deep_clear(right);
+            destroy_node(root);
+            throw;
+        }
+        root->left = left;
+        root->right = right;
+        if (left != nullptr) {
+            left->parent = root;
+        }
+        if (right != nullptr) {
+            right->parent = root;
+        }
+
+        return root;
+    }
+
+    pointer clone_node(pointer cur, pointer par) {
+        pointer new_node = create_node(cur->key);
         new_node->parent = par;
-        new_node->left = Copy(new_node, cur->left);
-        new_node->right = Copy(new_node, cur->right);
+        new_node->balance = cur->balance;
+        if constexpr (counted) {
+            new_node->count = cur->count;
+        }
 
         return new_node;
     }
 
+    template<typename InputIt>
+    static decltype(auto) range_value(const InputIt& i) {
+        if constexpr (std::is_convertible_v<const InputIt&, const value_type&>) {
+            return (i);
+        } else {
+            return *i;
+        }
+    }
+
+    static void append_node(pointer& head, pointer& tail, pointer temp) {
+        temp->left = nullptr;
+        temp->right = nullptr;
+        if (tail == nullptr) {
+            head = temp;
+        } else {
+            tail->right = temp;
+        }
+        tail = temp;
+    }
+
+    void destroy_list(pointer head) {
+        while (head != nullptr) {
+            pointer next = head->right;
+            destroy_node(head);
+            head = next;
+        }
+    }
+
+    pointer release_list() {
+        pointer head = nullptr;
+        pointer tail = nullptr;
+        pointer rest = header_.root;
+        while (rest != nullptr) {
+            if (rest->left != nullptr) {
+                pointer temp = rest->left;
+                rest->left = temp->right;
+                temp->right = rest;
+                rest = temp;
+            } else {
+                pointer next = rest->right;
+                if (tail == nullptr) {
+                    head = rest;
+                } else {
+                    tail->right = rest;
+                }
+                tail = rest;
+                rest = next;
+            }
+        }
+        header_ = header_type();
+        size_ = 0;
+
+        return head;
+    }
+
+    void filter_sorted(const BST& other, bool keep_common) {
+        pointer head = nullptr;
+        pointer tail = nullptr;
+        size_type count = 0;
+        pointer a = release_list();
+        auto b = other.cbegin<TraverseTag::In>();
+        auto b_end = other.cend<TraverseTag::In>();
+        while (a != nullptr) {
+            pointer next = a->right;
+            while (b != b_end && compare_(*b, a->key)) {
+                ++b;
+            }
+            bool common = b != b_end && !compare_(a->key, *b);
+            if (common == keep_common) {
+                append_node(head, tail, a);
+                ++count;
+            } else {
+                destroy_node(a);
+            }
+            a = next;
+        }
+        build_from_list(head, tail, count);
+    }
+
+    void assign_merged(const BST& lhs, const BST& rhs, bool lhs_only, bool both, bool rhs_only) {
+        pointer head = nullptr;
+        pointer tail = nullptr;
+        size_type count = 0;
+        auto a = lhs.cbegin<TraverseTag::In>();
+        auto a_end = lhs.cend<TraverseTag::In>();
+        auto b = rhs.cbegin<TraverseTag::In>();
+        auto b_end = rhs.cend<TraverseTag::In>();
+        try {
+            while (a != a_end || b != b_end) {
+                if (b == b_end || (a != a_end && compare_(*a, *b))) {
+                    if (lhs_only) {
+                        append_node(head, tail, create_node(*a));
+                        ++count;
+                    }
+                    ++a;
+                } else if (a == a_end || compare_(*b, *a)) {
+                    if (rhs_only) {
+                        append_node(head, tail, create_node(*b));
+                        ++count;
+                    }
+                    ++b;
+                } else {
+                    if (both) {
+                        append_node(head, tail, create_node(*a));
+                        ++count;
+                    }
+                    ++a;
+                    ++b;
+                }
+            }
+        } catch (...) {
+            destroy_list(head);
+            throw;
+        }
+        build_from_list(head, tail, count);
+    }
+
+    void build_from_list(pointer head, pointer tail, size_type count) {
+        if (count == 0) {
+            return;
+        }
+        int levels = 0;
+        for (size_type rest = count; rest != 0; rest >>= 1) {
+            ++levels;
+        }
+        if constexpr (threaded) {
+            pointer before = nullptr;
+            for (pointer temp = head; temp != nullptr; temp = temp->right) {
+                thread_between(temp, before, nullptr);
+                before = temp;
+            }
+        }
+        header_.root = build_subtree(head, count, 0, levels);
+        header_.root->parent = nullptr;
+        header_.leftmost = minimum_node(header_.root);
+        header_.rightmost = tail;
+        size_ = count;
+        invalidate_order_cache();
+    }
+
+    pointer build_subtree(pointer& list, size_type count, int depth, int levels) {
+        if (count == 0) {
+            return nullptr;
+        }
+        size_type left_count = count / 2;
+        pointer left = build_subtree(list, left_count, depth + 1, levels);
+        pointer temp = list;
+        list = list->right;
+        temp->left = left;
+        if (left != nullptr) {
+            left->parent = temp;
+        }
+        temp->right = build_subtree(list, count - left_count - 1, depth + 1, levels);
+        if (temp->right != nullptr) {
+            temp->right->parent = temp;
+        }
+        Balance::build(temp, depth, levels);
+        if constexpr (counted) {
+            temp->count = count;
+        }
+
+        return temp;
+    }
+
+    void copy_from(const BST& other) {
+        if (other.header_.root == nullptr) {
+            return;
+        }
+        header_.root = parallel_enabled(other.size_) ? parallel_copy(other.header_.root, parallel_depth())
+                                                     : Copy(other.header_.root);
+        header_.leftmost = minimum_node(header_.root);
+        header_.rightmost = maximum_node(header_.root);
+        size_ = other.size_;
+        if constexpr (threaded) {
+            thread_tree();
+        }
+    }
+
+    template<typename... Args>
+    pointer create_node(Args&&... args) {
+        pointer temp = std::allocator_traits<Allocator>::allocate(allocator_, 1);
+        try {
+            std::allocator_traits<Allocator>::construct(allocator_, temp, std::in_place, std::forward<Args>(args)...);
+        } catch (...) {
+            std::allocator_traits<Allocator>::deallocate(allocator_, temp, 1);
+            throw;
+        }
+
+        return temp;
+    }
+
+    void destroy_node(pointer temp) {
+        std::allocator_traits<Allocator>::destroy(allocator_, temp);
+        std::allocator_traits<Allocator>::deallocate(allocator_, temp, 1);
+    }
+
     void deep_clear(pointer temp) {
-        if (temp == nullptr) {
+        pointer stop = temp == nullptr ? nullptr : temp->parent;
+        while (temp != stop) {
+            if (temp->left != nullptr) {
+                temp = temp->left;
+            } else if (temp->right != nullptr) {
+                temp = temp->right;
+            } else {
+                pointer parent = temp->parent;
+                if (parent != stop) {
+                    if (parent->left == temp) {
+                        parent->left = nullptr;
+                    } else {
+                        parent->right = nullptr;
+                    }
+                }
+                destroy_node(temp);
+                temp = parent;
+            }
+        }
+    }
+
+    // deep_clear stops at the parent of its subtree, so sibling subtrees can be freed concurrently
+    void parallel_clear(pointer temp, int depth) {
+        if (depth == 0 || temp == nullptr) {
+            deep_clear(temp);
             return;
         }
-        deep_clear(temp->left);
-        deep_clear(temp->right);
-        allocator_.deallocate(temp, 1);
+        pointer left = temp->left;
+        pointer right = temp->right;
+        ThreadPool::instance().invoke([&] { parallel_clear(left, depth - 1); },
+                                      [&] { parallel_clear(right, depth - 1); });
+        destroy_node(temp);
+    }
+
+    void destroy_nodes(bool parallel) {
+        if constexpr (std::is_trivially_destructible_v<tree_node> && requires(Allocator& a) { a.release(); }) {
+            if (header_.root == nullptr || !allocator_.release()) {
+                deep_clear(header_.root);
+            }
+        } else if (parallel && parallel_enabled(size_)) {
+            parallel_clear(header_.root, parallel_depth());
+        } else {
+            deep_clear(header_.root);
+        }
+        header_ = header_type();
+        size_ = 0;
+    }
+
+    static bool parallel_enabled(size_type count) { return parallel_allocator && count >= parallel_cutoff; }
+
+    // about eight leaf tasks per pool thread on a balanced tree
+    static int parallel_depth() { return std::bit_width(ThreadPool::instance().size()) + 3; }
+
+    template<TraverseTag tag, typename Function>
+    void parallel_visit(pointer temp, int depth, Function& f) const {
+        if (depth == 0) {
+            visit_subtree<tag>(temp, f);
+            return;
+        }
+        if (tag == TraverseTag::Pre) {
+            f(static_cast<const_reference>(temp->key));
+        }
+        ThreadPool::instance().invoke(
+            [&] {
+                if (temp->left != nullptr) {
+                    parallel_visit<tag>(temp->left, depth - 1, f);
+                }
+            },
+            [&] {
+                if (temp->right != nullptr) {
+                    parallel_visit<tag>(temp->right, depth - 1, f);
+                }
+            });
+        if (tag != TraverseTag::Pre) {
+            f(static_cast<const_reference>(temp->key));
+        }
+    }
+
+    // walks one subtree in tag order with the ordinary iterators, which never leave it before its last node
+    template<TraverseTag tag, typename Function>
+    void visit_subtree(pointer temp, Function& f) const {
+        pointer first = temp;
+        pointer last = temp;
+        if (tag == TraverseTag::In) {
+            first = minimum_node(temp);
+            last = maximum_node(temp);
+        } else if (tag == TraverseTag::Pre) {
+            while (last->left != nullptr || last->right != nullptr) {
+                last = last->right != nullptr ? last->right : last->left;
+            }
+        } else {
+            while (first->left != nullptr || first->right != nullptr) {
+                first = first->left != nullptr ? first->left : first->right;
+            }
+        }
+        for (const_iterator<tag> it(first);; ++it) {
+            f(*it);
+            if (it.ptr_ == last) {
+                return;
+            }
+        }
     }
 
-    pointer next_node(pointer temp, value_type x) {
+    template<typename K>
+    pointer lower_node(const K& x) const {
+        pointer prev = nullptr;
+        pointer candidate = nullptr;
+        pointer temp = header_.root;
+        while (temp != nullptr) {
+            if (compare_(temp->key, x)) {
+                prev = temp;
+                temp = temp->right;
+            } else {
+                candidate = temp;
+                temp = temp->left;
+            }
+        }
+        if (candidate == nullptr || compare_(x, candidate->key)) {
+            return nullptr;
+        }
+
+        return prev;
+    }
+
+    template<typename K>
+    pointer upper_node(const K& x) const {
         pointer next = nullptr;
+        pointer candidate = nullptr;
+        pointer temp = header_.root;
         while (temp != nullptr) {
-            if (temp->key > x) {
+            if (compare_(x, temp->key)) {
                 next = temp;
                 temp = temp->left;
             } else {
+                candidate = temp;
                 temp = temp->right;
             }
         }
+        if (candidate == nullptr || compare_(candidate->key, x)) {
+            return nullptr;
+        }
+
         return next;
     }
 
-    pointer prev_node(pointer temp, value_type x) {
-        pointer prev = nullptr;
+    template<typename K>
+    pointer first_not_less(const K& x) const {
+        pointer result = nullptr;
+        pointer temp = header_.root;
         while (temp != nullptr) {
-            if (temp->key < x) {
-                prev = temp;
+            if (compare_(temp->key, x)) {
                 temp = temp->right;
             } else {
+                result = temp;
                 temp = temp->left;
             }
         }
-        return prev;
+
+        return result;
     }
 
-    void delete_node(pointer& root, T x) {
-        pointer temp = exist_node(root, x);
-        if (temp == nullptr) {
-            return;
+    std::pair<pointer, pointer> equal_nodes(const value_type& x) const {
+        pointer first = first_not_less(x);
+        if (first == nullptr || compare_(x, first->key)) {
+            return {first, first};
+        }
+        const_iterator<TraverseTag::In> last(first);
+        ++last;
+
+        return {first, last.ptr_};
+    }
+
+    void delete_node(pointer temp) {
+        unlink_node(temp);
+        destroy_node(temp);
+    }
+
+    void unlink_node(pointer temp) {
+        if constexpr (threaded) {
+            if (temp->prev != nullptr) {
+                temp->prev->next = temp->next;
+            }
+            if (temp->next != nullptr) {
+                temp->next->prev = temp->prev;
+            }
+            temp->prev = nullptr;
+            temp->next = nullptr;
+        }
+        if (temp == header_.leftmost) {
+            header_.leftmost = temp->right != nullptr ? minimum_node(temp->right) : temp->parent;
+        }
+        if (temp == header_.rightmost) {
+            header_.rightmost = temp->left != nullptr ? maximum_node(temp->left) : temp->parent;
+        }
+        pointer kid;
+        pointer kid_parent;
+        int removed = temp->balance;
+        if (temp->left == nullptr || temp->right == nullptr) {
+            kid = temp->left == nullptr ? temp->right : temp->left;
+            kid_parent = temp->parent;
+            if (kid != nullptr) {
+                kid->parent = kid_parent;
+            }
+            replace_child(temp, kid);
+        } else {
+            pointer successor = minimum_node(temp->right);
+            removed = successor->balance;
+            kid = successor->right;
+            if (successor->parent == temp) {
+                kid_parent = successor;
+            } else {
+                kid_parent = successor->parent;
+                if (kid != nullptr) {
+                    kid->parent = kid_parent;
+                }
+                kid_parent->left = kid;
+                successor->right = temp->right;
+                temp->right->parent = successor;
+            }
+            replace_child(temp, successor);
+            successor->parent = temp->parent;
+            successor->left = temp->left;
+            temp->left->parent = successor;
+            successor->balance = temp->balance;
+            if constexpr (counted) {
+                successor->count = temp->count;
+            }
+        }
+        if constexpr (counted) {
+            for (pointer p = kid_parent; p != nullptr; p = p->parent) {
+                --p->count;
+            }
+        }
+        Balance::erase_fixup(kid, kid_parent, removed, header_.root);
+        invalidate_order_cache();
+        --size_;
+    }
+
+    template<typename K>
+    std::pair<pointer, bool> insert_node(K&& x) {
+        pointer parent;
+        bool left;
+        pointer found = find_slot(x, parent, left);
+        if (found != nullptr) {
+            return {found, false};
+        }
+        pointer temp = create_node(std::forward<K>(x));
+        link_node(temp, parent, left);
+
+        return {temp, true};
+    }
+
+    pointer find_slot(const value_type& x, pointer& parent, bool& left) const {
+        parent = nullptr;
+        left = false;
+        pointer candidate = nullptr;
+        pointer temp = header_.root;
+        while (temp != nullptr) {
+            parent = temp;
+            left = compare_(x, temp->key);
+            if (left) {
+                temp = temp->left;
+            } else {
+                candidate = temp;
+                temp = temp->right;
+            }
+        }
+        if (candidate != nullptr && !compare_(candidate->key, x)) {
+            return candidate;
+        }
+
+        return nullptr;
+    }
+
+    pointer hint_slot(pointer hint, const value_type& x, pointer& parent, bool& left) const {
+        if (hint == nullptr) {
+            if (header_.rightmost != nullptr && compare_(header_.rightmost->key, x)) {
+                parent = header_.rightmost;
+                left = false;
+
+                return nullptr;
+            }
+        } else if (compare_(x, hint->key)) {
+            if (hint == header_.leftmost) {
+                parent = hint;
+                left = true;
+
+                return nullptr;
+            }
+            const_iterator<TraverseTag::In> before(hint);
+            --before;
+            if (compare_(before.ptr_->key, x)) {
+                if (before.ptr_->right == nullptr) {
+                    parent = before.ptr_;
+                    left = false;
+                } else {
+                    parent = hint;
+                    left = true;
+                }
+
+                return nullptr;
+            }
+        } else if (compare_(hint->key, x)) {
+            if (hint == header_.rightmost) {
+                parent = hint;
+                left = false;
+
+                return nullptr;
+            }
+            const_iterator<TraverseTag::In> after(hint);
+            ++after;
+            if (compare_(x, after.ptr_->key)) {
+                if (hint->right == nullptr) {
+                    parent = hint;
+                    left = false;
+                } else {
+                    parent = after.ptr_;
+                    left = true;
+                }
+
+                return nullptr;
+            }
+        } else {
+            return hint;
         }
-        if (temp->left == nullptr && temp->right == nullptr) {
-            if (temp != root) {
-                swap_nodes(temp, nullptr);
+
+        return find_slot(x, parent, left);
+    }
+
+    void link_node(pointer temp, pointer parent, bool left) {
+        temp->parent = parent;
+        Balance::init(temp);
+        if constexpr (threaded) {
+            if (parent == nullptr) {
+                thread_between(temp, nullptr, nullptr);
+            } else if (left) {
+                thread_between(temp, parent->prev, parent);
             } else {
-                root = nullptr;
+                thread_between(temp, parent, parent->next);
+            }
+        }
+        if (parent == nullptr) {
+            header_.root = temp;
+            header_.leftmost = temp;
+            header_.rightmost = temp;
+        } else if (left) {
+            parent->left = temp;
+            if (parent == header_.leftmost) {
+                header_.leftmost = temp;
+            }
+        } else {
+            parent->right = temp;
+            if (parent == header_.rightmost) {
+                header_.rightmost = temp;
+            }
+        }
+        if constexpr (counted) {
+            temp->count = 1;
+            for (pointer p = parent; p != nullptr; p = p->parent) {
+                ++p->count;
+            }
+        }
+        Balance::insert_fixup(temp, header_.root);
+        invalidate_order_cache();
+        ++size_;
+    }
+
+    template<typename K>
+    pointer exist_node(pointer temp, const K& x) const {
+        pointer candidate = nullptr;
+        while (temp != nullptr) {
+            if (compare_(temp->key, x)) {
+                temp = temp->right;
+            } else {
+                candidate = temp;
+                temp = temp->left;
             }
-            allocator_.deallocate(temp, 1);
-        } else if (temp->left == nullptr || temp->right == nullptr) {
-            pointer kid = temp->left == nullptr ? temp->right : temp->left;
-            if (temp != root) {
-                swap_nodes(temp, kid);
+        }
+        if (candidate != nullptr && !compare_(x, candidate->key)) {
+            return candidate;
+        }
+
+        return nullptr;
+    }
+
+    static void check_batch(size_type keys, size_type out) {
+        if (out < keys) {
+            std::cerr << "..error";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    // advances up to batch_group descents one level per round so their cache misses overlap
+    template<typename Store>
+    void descend_batch(std::span<const value_type> keys, Store store) const {
+        pointer cursor[batch_group];
+        pointer candidate[batch_group];
+        for (size_type base = 0; base < keys.size(); base += batch_group) {
+            size_type lanes = keys.size() - base < batch_group ? keys.size() - base : batch_group;
+            for (size_type i = 0; i < lanes; ++i) {
+                cursor[i] = header_.root;
+                candidate[i] = nullptr;
+            }
+            for (size_type active = lanes; active != 0;) {
+                active = 0;
+                for (size_type i = 0; i < lanes; ++i) {
+                    pointer temp = cursor[i];
+                    if (temp == nullptr) {
+                        continue;
+                    }
+                    if (compare_(temp->key, keys[base + i])) {
+                        temp = temp->right;
+                    } else {
+                        candidate[i] = temp;
+                        temp = temp->left;
+                    }
+                    cursor[i] = temp;
+                    if (temp != nullptr) {
+#if defined(__GNUC__)
+                        __builtin_prefetch(temp);
+#endif
+                        ++active;
+                    }
+                }
+            }
+            for (size_type i = 0; i < lanes; ++i) {
+                pointer found = candidate[i];
+                store(base + i, found != nullptr && !compare_(keys[base + i], found->key) ? found : nullptr);
+            }
+        }
+    }
+
+    static void thread_between(pointer temp, pointer before, pointer after) {
+        temp->prev = before;
+        temp->next = after;
+        if (before != nullptr) {
+            before->next = temp;
+        }
+        if (after != nullptr) {
+            after->prev = temp;
+        }
+    }
+
+    // rebuilds every in-order link from the tree shape after whole subtrees were cloned at once
+    void thread_tree() {
+        pointer before = nullptr;
+        pointer temp = header_.leftmost;
+        while (temp != nullptr) {
+            thread_between(temp, before, nullptr);
+            before = temp;
+            if (temp->right != nullptr) {
+                temp = minimum_node(temp->right);
             } else {
-                root = kid;
+                while (temp->parent != nullptr && temp == temp->parent->right) {
+                    temp = temp->parent;
+                }
+                temp = temp->parent;
             }
-            kid->parent = temp->parent;
-            allocator_.deallocate(temp, 1);
+        }
+    }
+
+    void replace_child(pointer old_node, pointer new_node) {
+        if (old_node->parent == nullptr) {
+            header_.root = new_node;
+        } else if (old_node == old_node->parent->left) {
+            old_node->parent->left = new_node;
         } else {
-            pointer successor = minimum_node(temp->right);
-            value_type key =  successor->key;
-            delete_node(root, successor->key);
-            temp->key = key;
+            old_node->parent->right = new_node;
         }
     }
 
-    pointer insert_node(pointer temp, pointer parent, value_type x) {
-        if (temp == nullptr) {
-            temp = allocator_.allocate(1);
-            temp->key = x;
-            temp->parent = parent;
-        } else if (x > temp->key) {
-            pointer right = insert_node(temp->right, temp, x);
-            temp->right = right;
-        } else if (x < temp->key) {
-            pointer left = insert_node(temp->left, temp, x);
-            temp->left = left;
+    static size_type subtree_count(pointer temp) { return temp == nullptr ? 0 : temp->count; }
+
+    static pointer root_of(pointer temp) {
+        while (temp->parent != nullptr) {
+            temp = temp->parent;
         }
+
         return temp;
     }
 
-    pointer exist_node(pointer temp, value_type x) {
+    static size_type position(pointer root, pointer temp) {
         if (temp == nullptr) {
-            return nullptr;
+            return subtree_count(root);
         }
-        if (x == temp->key) {
-            return temp;
-        } else if (x < temp->key) {
-            return exist_node(temp->left, x);
-        } else {
-            return exist_node(temp->right, x);
+        size_type result = subtree_count(temp->left);
+        while (temp->parent != nullptr) {
+            if (temp == temp->parent->right) {
+                result += subtree_count(temp->parent->left) + 1;
+            }
+            temp = temp->parent;
         }
+
+        return result;
     }
 
-    void swap_nodes(pointer root, pointer temp) {
-        if (root->parent != nullptr) {
-            if (root != root->parent->left) {
-                root->parent->right = temp;
+    static pointer select(pointer temp, size_type k) {
+        while (temp != nullptr) {
+            size_type left = subtree_count(temp->left);
+            if (k < left) {
+                temp = temp->left;
+            } else if (k == left) {
+                return temp;
             } else {
-                root->parent->left = temp;
+                k -= left + 1;
+                temp = temp->right;
             }
         }
+
+        return nullptr;
     }
 
-    pointer minimum_node(pointer temp) {
-        if (temp->left == nullptr) {
-            return temp;
+    pointer minimum_node(pointer temp) const {
+        while (temp->left != nullptr) {
+            temp = temp->left;
+        }
+
+        return temp;
+    }
+
+    pointer maximum_node(pointer temp) const {
+        while (temp->right != nullptr) {
+            temp = temp->right;
+        }
+
+        return temp;
+    }
+
+    template<TraverseTag tag>
+    pointer first_node() const {
+        if (tag == TraverseTag::In) {
+            return header_.leftmost;
         }
-        return minimum_node(temp->left);
+        if (tag == TraverseTag::Post) {
+            if (header_.post_first == nullptr && header_.leftmost != nullptr) {
+                pointer temp = header_.leftmost;
+                while (temp->left != nullptr || temp->right != nullptr) {
+                    temp = temp->left != nullptr ? temp->left : temp->right;
+                }
+                header_.post_first = temp;
+            }
+
+            return header_.post_first;
+        }
+
+        return header_.root;
+    }
+
+    template<TraverseTag tag>
+    pointer last_node() const {
+        if (tag == TraverseTag::In) {
+            return header_.rightmost;
+        }
+        if (tag == TraverseTag::Pre) {
+            if (header_.pre_last == nullptr && header_.rightmost != nullptr) {
+                pointer temp = header_.rightmost;
+                while (temp->right != nullptr || temp->left != nullptr) {
+                    temp = temp->right != nullptr ? temp->right : temp->left;
+                }
+                header_.pre_last = temp;
+            }
+
+            return header_.pre_last;
+        }
+
+        return header_.root;
+    }
+
+    void set_root(pointer root, size_type count) {
+        header_ = header_type();
+        header_.root = root;
+        if (root != nullptr) {
+            header_.leftmost = minimum_node(root);
+            header_.rightmost = maximum_node(root);
+        }
+        size_ = count;
+    }
+
+    size_type lower_count(pointer lower, pointer upper, size_type total) const {
+        if constexpr (counted) {
+            return subtree_count(lower);
+        } else {
+            const_iterator<TraverseTag::In> i(lower != nullptr ? minimum_node(lower) : nullptr);
+            const_iterator<TraverseTag::In> j(upper != nullptr ? minimum_node(upper) : nullptr);
+            size_type steps = 0;
+            while (i.ptr_ != nullptr && j.ptr_ != nullptr) {
+                ++i;
+                ++j;
+                ++steps;
+            }
+
+            return i.ptr_ == nullptr ? steps : total - steps;
+        }
+    }
+
+    void invalidate_order_cache() {
+        header_.post_first = nullptr;
+        header_.pre_last = nullptr;
     }
 };
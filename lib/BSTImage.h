@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// on-disk image written by BST::save and read by MappedBST: this header, zero padding up to keys_offset, then
+// count keys in Eytzinger order, so the file needs no pointers and no parsing
+struct BSTImageHeader {
+    static constexpr char expected_magic[8] = {'B', 'S', 'T', 'I', 'M', 'A', 'G', 'E'};
+    static constexpr uint32_t current_version = 1;
+    static constexpr uint32_t native_byte_order = 0x01020304;
+    static constexpr size_t keys_offset = 64;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t key_size;
+    uint32_t key_align;
+    uint64_t count;
+    uint64_t checksum;
+
+    template<typename T>
+    static BSTImageHeader make(uint64_t count, uint64_t checksum) {
+        BSTImageHeader header;
+        std::memcpy(header.magic, expected_magic, sizeof(magic));
+        header.version = current_version;
+        header.byte_order = native_byte_order;
+        header.key_size = sizeof(T);
+        header.key_align = alignof(T);
+        header.count = count;
+        header.checksum = checksum;
+
+        return header;
+    }
+
+    template<typename T>
+    bool matches() const {
+        return std::memcmp(magic, expected_magic, sizeof(magic)) == 0 && version == current_version
+               && byte_order == native_byte_order && key_size == sizeof(T) && key_align == alignof(T);
+    }
+
+    // FNV-1a style xor-multiply over 64-bit words in four independent lanes, so checking a mapped image runs
+    // at memory speed rather than one multiply per byte
+    static uint64_t checksum_of(const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        const uint64_t prime = 1099511628211ull;
+        uint64_t lanes[4] = {14695981039346656037ull, 1, 2, 3};
+        size_t i = 0;
+        for (; i + 32 <= bytes; i += 32) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                uint64_t word;
+                std::memcpy(&word, p + i + 8 * lane, sizeof(word));
+                lanes[lane] = (lanes[lane] ^ word) * prime;
+            }
+        }
+        uint64_t hash = lanes[0];
+        for (size_t lane = 1; lane < 4; ++lane) {
+            hash = (hash ^ lanes[lane]) * prime;
+        }
+        for (; i < bytes; ++i) {
+            hash = (hash ^ p[i]) * prime;
+        }
+
+        return (hash ^ bytes) * prime;
+    }
+};
+
+static_assert(sizeof(BSTImageHeader) <= BSTImageHeader::keys_offset, "BSTImageHeader must fit before the keys");
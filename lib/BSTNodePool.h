@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+template<typename T, size_t MaxChunkNodes = 65536>
+class BSTNodePool {
+public:
+    typedef T value_type;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    template<typename U>
+    struct rebind {
+        typedef BSTNodePool<U, MaxChunkNodes> other;
+    };
+
+    BSTNodePool() : pool_(std::make_shared<Pool>()) {}
+
+    BSTNodePool(const BSTNodePool& other) = default;
+
+    template<typename U>
+    BSTNodePool(const BSTNodePool<U, MaxChunkNodes>&) : pool_(std::make_shared<Pool>()) {}
+
+    BSTNodePool& operator=(const BSTNodePool& other) = default;
+
+    T* allocate(size_type n) {
+        if (n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        Pool& pool = *pool_;
+        if (pool.free_list != nullptr) {
+            Slot* slot = pool.free_list;
+            pool.free_list = slot->next;
+
+            return reinterpret_cast<T*>(slot);
+        }
+        if (pool.cursor == pool.chunk_end) {
+            pool.grow();
+        }
+        Slot* slot = pool.cursor++;
+
+        return reinterpret_cast<T*>(slot);
+    }
+
+    void deallocate(T* p, size_type n) {
+        if (n != 1) {
+            ::operator delete(p, std::align_val_t(alignof(T)));
+            return;
+        }
+        Slot* slot = reinterpret_cast<Slot*>(p);
+        slot->next = pool_->free_list;
+        pool_->free_list = slot;
+    }
+
+    bool release() {
+        if (pool_.use_count() != 1) {
+            return false;
+        }
+        pool_->reset();
+
+        return true;
+    }
+
+    size_type chunk_count() const { return pool_->chunks.size(); }
+
+    BSTNodePool select_on_container_copy_construction() const { return BSTNodePool(); }
+
+    bool operator==(const BSTNodePool& other) const { return pool_ == other.pool_; }
+    bool operator!=(const BSTNodePool& other) const { return pool_ != other.pool_; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct Pool {
+        std::vector<Slot*> chunks;
+        Slot* free_list = nullptr;
+        Slot* cursor = nullptr;
+        Slot* chunk_end = nullptr;
+        size_type next_chunk_nodes = 32;
+
+        Pool() = default;
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        ~Pool() { reset(); }
+
+        void grow() {
+            Slot* chunk = static_cast<Slot*>(::operator new(next_chunk_nodes * sizeof(Slot), std::align_val_t(alignof(Slot))));
+            chunks.push_back(chunk);
+            cursor = chunk;
+            chunk_end = chunk + next_chunk_nodes;
+            if (next_chunk_nodes < MaxChunkNodes) {
+                next_chunk_nodes *= 2;
+            }
+        }
+
+        void reset() {
+            for (Slot* chunk : chunks) {
+                ::operator delete(chunk, std::align_val_t(alignof(Slot)));
+            }
+            chunks.clear();
+            free_list = nullptr;
+            cursor = nullptr;
+            chunk_end = nullptr;
+            next_chunk_nodes = 32;
+        }
+    };
+
+    template<typename U, size_t N>
+    friend class BSTNodePool;
+
+    std::shared_ptr<Pool> pool_;
+};
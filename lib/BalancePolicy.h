@@ -0,0 +1,416 @@
+#pragma once
+
+struct BalanceBase {
+    template<typename NodePtr>
+    static void rotate_left(NodePtr x, NodePtr& root) {
+        NodePtr y = x->right;
+        x->right = y->left;
+        if (y->left != nullptr) {
+            y->left->parent = x;
+        }
+        y->parent = x->parent;
+        if (x->parent == nullptr) {
+            root = y;
+        } else if (x == x->parent->left) {
+            x->parent->left = y;
+        } else {
+            x->parent->right = y;
+        }
+        y->left = x;
+        x->parent = y;
+        update_count(x);
+        update_count(y);
+    }
+
+    template<typename NodePtr>
+    static void rotate_right(NodePtr x, NodePtr& root) {
+        NodePtr y = x->left;
+        x->left = y->right;
+        if (y->right != nullptr) {
+            y->right->parent = x;
+        }
+        y->parent = x->parent;
+        if (x->parent == nullptr) {
+            root = y;
+        } else if (x == x->parent->right) {
+            x->parent->right = y;
+        } else {
+            x->parent->left = y;
+        }
+        y->right = x;
+        x->parent = y;
+        update_count(x);
+        update_count(y);
+    }
+
+    template<typename NodePtr>
+    static void update_count(NodePtr x) {
+        if constexpr (requires { x->count; }) {
+            x->count = 1 + (x->left != nullptr ? x->left->count : 0) + (x->right != nullptr ? x->right->count : 0);
+        }
+    }
+
+    template<typename NodePtr>
+    static void update_path(NodePtr x) {
+        if constexpr (requires { x->count; }) {
+            for (; x != nullptr; x = x->parent) {
+                update_count(x);
+            }
+        }
+    }
+
+    template<typename NodePtr>
+    static void attach(NodePtr pivot, NodePtr left, NodePtr right) {
+        pivot->left = left;
+        pivot->right = right;
+        if (left != nullptr) {
+            left->parent = pivot;
+        }
+        if (right != nullptr) {
+            right->parent = pivot;
+        }
+        update_count(pivot);
+    }
+};
+
+struct NoBalancePolicy : BalanceBase {
+    template<typename NodePtr>
+    static void init(NodePtr x) { x->balance = 0; }
+
+    template<typename NodePtr>
+    static void insert_fixup(NodePtr, NodePtr&) {}
+
+    template<typename NodePtr>
+    static void erase_fixup(NodePtr, NodePtr, int, NodePtr&) {}
+
+    template<typename NodePtr>
+    static void build(NodePtr x, int, int) { x->balance = 0; }
+
+    template<typename NodePtr>
+    static int rank(NodePtr) { return 0; }
+
+    template<typename NodePtr>
+    static int child_rank(NodePtr, int, NodePtr) { return 0; }
+
+    template<typename NodePtr>
+    static NodePtr join(NodePtr left, int, NodePtr pivot, NodePtr right, int, int& rank) {
+        pivot->balance = 0;
+        attach(pivot, left, right);
+        rank = 0;
+
+        return pivot;
+    }
+};
+
+struct RedBlackPolicy : BalanceBase {
+    static constexpr int red = 0;
+    static constexpr int black = 1;
+
+    template<typename NodePtr>
+    static void init(NodePtr x) { x->balance = red; }
+
+    template<typename NodePtr>
+    static void build(NodePtr x, int depth, int levels) {
+        x->balance = depth > 0 && depth == levels - 1 ? red : black;
+    }
+
+    template<typename NodePtr>
+    static void insert_fixup(NodePtr x, NodePtr& root) { fix_red(x, root); }
+
+    template<typename NodePtr>
+    static int rank(NodePtr x) {
+        if (x == nullptr) {
+            return 0;
+        }
+        int result = x->balance == red ? 1 : 0;
+        for (; x != nullptr; x = x->left) {
+            result += x->balance == black ? 1 : 0;
+        }
+
+        return result;
+    }
+
+    template<typename NodePtr>
+    static int child_rank(NodePtr, int parent_rank, NodePtr child) {
+        return parent_rank - 1 + (child != nullptr && child->balance == red ? 1 : 0);
+    }
+
+    template<typename NodePtr>
+    static NodePtr join(NodePtr left, int left_rank, NodePtr pivot, NodePtr right, int right_rank, int& rank) {
+        if (left != nullptr) {
+            left->balance = black;
+        }
+        if (right != nullptr) {
+            right->balance = black;
+        }
+        if (left_rank == right_rank) {
+            pivot->balance = black;
+            attach(pivot, left, right);
+            rank = left_rank + 1;
+
+            return pivot;
+        }
+        pivot->balance = red;
+        NodePtr root;
+        if (left_rank > right_rank) {
+            NodePtr parent = nullptr;
+            NodePtr cur = left;
+            int cur_rank = left_rank;
+            while (cur != nullptr && (cur->balance == red || cur_rank != right_rank)) {
+                cur_rank -= cur->balance == black ? 1 : 0;
+                parent = cur;
+                cur = cur->right;
+            }
+            attach(pivot, cur, right);
+            parent->right = pivot;
+            pivot->parent = parent;
+            root = left;
+            rank = left_rank;
+        } else {
+            NodePtr parent = nullptr;
+            NodePtr cur = right;
+            int cur_rank = right_rank;
+            while (cur != nullptr && (cur->balance == red || cur_rank != left_rank)) {
+                cur_rank -= cur->balance == black ? 1 : 0;
+                parent = cur;
+                cur = cur->left;
+            }
+            attach(pivot, left, cur);
+            parent->left = pivot;
+            pivot->parent = parent;
+            root = right;
+            rank = right_rank;
+        }
+        update_path(pivot->parent);
+        if (fix_red(pivot, root)) {
+            ++rank;
+        }
+
+        return root;
+    }
+
+    template<typename NodePtr>
+    static void erase_fixup(NodePtr x, NodePtr x_parent, int removed, NodePtr& root) {
+        if (removed != black) {
+            return;
+        }
+        while (x != root && (x == nullptr || x->balance == black)) {
+            if (x == x_parent->left) {
+                NodePtr w = x_parent->right;
+                if (w->balance == red) {
+                    w->balance = black;
+                    x_parent->balance = red;
+                    rotate_left(x_parent, root);
+                    w = x_parent->right;
+                }
+                if (is_black(w->left) && is_black(w->right)) {
+                    w->balance = red;
+                    x = x_parent;
+                    x_parent = x_parent->parent;
+                } else {
+                    if (is_black(w->right)) {
+                        w->left->balance = black;
+                        w->balance = red;
+                        rotate_right(w, root);
+                        w = x_parent->right;
+                    }
+                    w->balance = x_parent->balance;
+                    x_parent->balance = black;
+                    if (w->right != nullptr) {
+                        w->right->balance = black;
+                    }
+                    rotate_left(x_parent, root);
+                    break;
+                }
+            } else {
+                NodePtr w = x_parent->left;
+                if (w->balance == red) {
+                    w->balance = black;
+                    x_parent->balance = red;
+                    rotate_right(x_parent, root);
+                    w = x_parent->left;
+                }
+                if (is_black(w->right) && is_black(w->left)) {
+                    w->balance = red;
+                    x = x_parent;
+                    x_parent = x_parent->parent;
+                } else {
+                    if (is_black(w->left)) {
+                        w->right->balance = black;
+                        w->balance = red;
+                        rotate_left(w, root);
+                        w = x_parent->left;
+                    }
+                    w->balance = x_parent->balance;
+                    x_parent->balance = black;
+                    if (w->left != nullptr) {
+                        w->left->balance = black;
+                    }
+                    rotate_right(x_parent, root);
+                    break;
+                }
+            }
+        }
+        if (x != nullptr) {
+            x->balance = black;
+        }
+    }
+
+private:
+    template<typename NodePtr>
+    static bool fix_red(NodePtr x, NodePtr& root) {
+        while (x != root && x->parent->balance == red) {
+            NodePtr parent = x->parent;
+            NodePtr grand = parent->parent;
+            if (parent == grand->left) {
+                NodePtr uncle = grand->right;
+                if (uncle != nullptr && uncle->balance == red) {
+                    parent->balance = black;
+                    uncle->balance = black;
+                    grand->balance = red;
+                    x = grand;
+                } else {
+                    if (x == parent->right) {
+                        x = parent;
+                        rotate_left(x, root);
+                        parent = x->parent;
+                    }
+                    parent->balance = black;
+                    grand->balance = red;
+                    rotate_right(grand, root);
+                }
+            } else {
+                NodePtr uncle = grand->left;
+                if (uncle != nullptr && uncle->balance == red) {
+                    parent->balance = black;
+                    uncle->balance = black;
+                    grand->balance = red;
+                    x = grand;
+                } else {
+                    if (x == parent->left) {
+                        x = parent;
+                        rotate_right(x, root);
+                        parent = x->parent;
+                    }
+                    parent->balance = black;
+                    grand->balance = red;
+                    rotate_left(grand, root);
+                }
+            }
+        }
+        bool grew = root->balance == red;
+        root->balance = black;
+
+        return grew;
+    }
+
+    template<typename NodePtr>
+    static bool is_black(NodePtr x) { return x == nullptr || x->balance == black; }
+};
+
+struct AVLPolicy : BalanceBase {
+    template<typename NodePtr>
+    static void init(NodePtr x) { x->balance = 1; }
+
+    template<typename NodePtr>
+    static void insert_fixup(NodePtr x, NodePtr& root) { retrace(x->parent, root); }
+
+    template<typename NodePtr>
+    static void erase_fixup(NodePtr, NodePtr x_parent, int, NodePtr& root) { retrace(x_parent, root); }
+
+    template<typename NodePtr>
+    static void build(NodePtr x, int, int) { update(x); }
+
+    template<typename NodePtr>
+    static int rank(NodePtr x) { return height(x); }
+
+    template<typename NodePtr>
+    static int child_rank(NodePtr, int, NodePtr child) { return height(child); }
+
+    template<typename NodePtr>
+    static NodePtr join(NodePtr left, int, NodePtr pivot, NodePtr right, int, int& rank) {
+        int left_height = height(left);
+        int right_height = height(right);
+        NodePtr root;
+        if (left_height > right_height + 1) {
+            NodePtr parent = nullptr;
+            NodePtr cur = left;
+            while (height(cur) > right_height + 1) {
+                parent = cur;
+                cur = cur->right;
+            }
+            attach(pivot, cur, right);
+            update(pivot);
+            parent->right = pivot;
+            pivot->parent = parent;
+            root = left;
+            update_path(parent);
+            retrace(parent, root);
+        } else if (right_height > left_height + 1) {
+            NodePtr parent = nullptr;
+            NodePtr cur = right;
+            while (height(cur) > left_height + 1) {
+                parent = cur;
+                cur = cur->left;
+            }
+            attach(pivot, left, cur);
+            update(pivot);
+            parent->left = pivot;
+            pivot->parent = parent;
+            root = right;
+            update_path(parent);
+            retrace(parent, root);
+        } else {
+            attach(pivot, left, right);
+            update(pivot);
+            root = pivot;
+        }
+        rank = height(root);
+
+        return root;
+    }
+
+    template<typename NodePtr>
+    static int height(NodePtr x) { return x == nullptr ? 0 : x->balance; }
+
+    template<typename NodePtr>
+    static void update(NodePtr x) {
+        int left = height(x->left);
+        int right = height(x->right);
+        x->balance = 1 + (left > right ? left : right);
+    }
+
+    template<typename NodePtr>
+    static void retrace(NodePtr p, NodePtr& root) {
+        while (p != nullptr) {
+            int old = p->balance;
+            update(p);
+            int diff = height(p->left) - height(p->right);
+            if (diff > 1) {
+                if (height(p->left->left) < height(p->left->right)) {
+                    NodePtr child = p->left;
+                    rotate_left(child, root);
+                    update(child);
+                }
+                rotate_right(p, root);
+                update(p);
+                p = p->parent;
+                update(p);
+            } else if (diff < -1) {
+                if (height(p->right->right) < height(p->right->left)) {
+                    NodePtr child = p->right;
+                    rotate_right(child, root);
+                    update(child);
+                }
+                rotate_left(p, root);
+                update(p);
+                p = p->parent;
+                update(p);
+            }
+            if (p->balance == old) {
+                return;
+            }
+            p = p->parent;
+        }
+    }
+};
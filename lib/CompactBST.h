@@ -0,0 +1,754 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#include "BST.h"
+
+// red-black tree whose nodes live in one contiguous buffer and link to each other by 32-bit indices; slot 0 is
+// the shared black leaf, erased slots are chained into a free list through their left link, and the colour bit
+// is packed into the parent index
+template<typename T, typename Compare = std::less<T> >
+class CompactBST {
+    typedef uint32_t index_type;
+
+    static constexpr index_type red_bit = 0x80000000u;
+    static constexpr index_type free_mark = 0xFFFFFFFFu;
+    static constexpr size_t max_nodes = 0x7FFFFFFEu;
+
+    struct slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        index_type left;
+        index_type right;
+        index_type parent_color;
+
+        T& key() { return *std::launder(reinterpret_cast<T*>(storage)); }
+        const T& key() const { return *std::launder(reinterpret_cast<const T*>(storage)); }
+    };
+
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    // bytes each element occupies in the buffer, links and colour included
+    static constexpr size_type slot_size = sizeof(slot);
+
+    template<TraverseTag tag>
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator() : tree_(nullptr), index_(0) {}
+
+        reference operator*() const { return tree_->slots_[index_].key(); }
+        pointer operator->() const { return &tree_->slots_[index_].key(); }
+
+        const_iterator& operator++() {
+            index_ = tree_->template next<tag>(index_);
+
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+
+            return temp;
+        }
+
+        const_iterator& operator--() {
+            index_ = tree_->template prev<tag>(index_);
+
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator temp = *this;
+            --*this;
+
+            return temp;
+        }
+
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        friend class CompactBST;
+
+        const_iterator(const CompactBST* tree, index_type index) : tree_(tree), index_(index) {}
+
+        const CompactBST* tree_;
+        index_type index_;
+    };
+
+    template<TraverseTag tag>
+    using iterator = const_iterator<tag>;
+
+    template<TraverseTag tag>
+    using const_reverse_iterator = std::reverse_iterator<const_iterator<tag> >;
+
+    template<TraverseTag tag>
+    using reverse_iterator = const_reverse_iterator<tag>;
+
+    CompactBST() : CompactBST(Compare()) {}
+
+    explicit CompactBST(const Compare& compare)
+        : slots_(nullptr), capacity_(0), used_(0), free_(0), size_(0), root_(0), compare_(compare) {}
+
+    template<typename InputIt>
+    CompactBST(InputIt i, InputIt j) : CompactBST() {
+        insert(i, j);
+    }
+
+    CompactBST(std::initializer_list<value_type> il) : CompactBST() { insert(il.begin(), il.end()); }
+
+    CompactBST(const CompactBST& other)
+        : slots_(nullptr), capacity_(0), used_(0), free_(other.free_), size_(other.size_), root_(other.root_),
+          compare_(other.compare_) {
+        if (other.slots_ == nullptr) {
+            return;
+        }
+        slots_ = allocate(other.capacity_);
+        capacity_ = other.capacity_;
+        for (; used_ < other.used_; ++used_) {
+            const slot& from = other.slots_[used_];
+            slot& to = slots_[used_];
+            to.left = from.left;
+            to.right = from.right;
+            to.parent_color = from.parent_color;
+            if (live(used_, other.slots_)) {
+                ::new (static_cast<void*>(to.storage)) T(from.key());
+            }
+        }
+    }
+
+    CompactBST(CompactBST&& other) noexcept
+        : slots_(other.slots_), capacity_(other.capacity_), used_(other.used_), free_(other.free_),
+          size_(other.size_), root_(other.root_), compare_(other.compare_) {
+        other.slots_ = nullptr;
+        other.capacity_ = 0;
+        other.used_ = 0;
+        other.free_ = 0;
+        other.size_ = 0;
+        other.root_ = 0;
+    }
+
+    CompactBST& operator=(const CompactBST& other) {
+        if (this != &other) {
+            CompactBST temp(other);
+            swap(temp);
+        }
+
+        return *this;
+    }
+
+    CompactBST& operator=(CompactBST&& other) noexcept {
+        if (this != &other) {
+            swap(other);
+            other.clear();
+        }
+
+        return *this;
+    }
+
+    ~CompactBST() {
+        destroy_keys();
+        deallocate(slots_);
+    }
+
+    bool operator==(const CompactBST& other) const {
+        if (size_ != other.size_) {
+            return false;
+        }
+        auto it = other.cbegin<TraverseTag::In>();
+        for (auto mine = cbegin<TraverseTag::In>(); mine != cend<TraverseTag::In>(); ++mine, ++it) {
+            if (compare_(*mine, *it) || compare_(*it, *mine)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool operator!=(const CompactBST& other) const { return !(*this == other); }
+
+    void swap(CompactBST& other) noexcept {
+        std::swap(slots_, other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(used_, other.used_);
+        std::swap(free_, other.free_);
+        std::swap(size_, other.size_);
+        std::swap(root_, other.root_);
+        std::swap(compare_, other.compare_);
+    }
+
+    size_type size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    // slots allocated, including the shared leaf and erased slots waiting on the free list
+    size_type capacity() const { return capacity_; }
+
+    key_compare key_comp() const { return compare_; }
+
+    value_compare value_comp() const { return compare_; }
+
+    void reserve(size_type n) {
+        if (n + 1 > capacity_ || slots_ == nullptr) {
+            grow(n + 1);
+        }
+    }
+
+    template<TraverseTag tag>
+    const_iterator<tag> begin() const { return const_iterator<tag>(this, first<tag>()); }
+
+    template<TraverseTag tag>
+    const_iterator<tag> end() const { return const_iterator<tag>(this, 0); }
+
+    template<TraverseTag tag>
+    const_iterator<tag> cbegin() const { return begin<tag>(); }
+
+    template<TraverseTag tag>
+    const_iterator<tag> cend() const { return end<tag>(); }
+
+    template<TraverseTag tag>
+    const_reverse_iterator<tag> rbegin() const { return const_reverse_iterator<tag>(end<tag>()); }
+
+    template<TraverseTag tag>
+    const_reverse_iterator<tag> rend() const { return const_reverse_iterator<tag>(begin<tag>()); }
+
+    template<TraverseTag tag>
+    const_reverse_iterator<tag> crbegin() const { return rbegin<tag>(); }
+
+    template<TraverseTag tag>
+    const_reverse_iterator<tag> crend() const { return rend<tag>(); }
+
+    void clear() {
+        destroy_keys();
+        used_ = slots_ == nullptr ? 0 : 1;
+        free_ = 0;
+        size_ = 0;
+        root_ = 0;
+    }
+
+    std::pair<const_iterator<TraverseTag::In>, bool> insert_check(const value_type& value) {
+        index_type parent = 0;
+        index_type candidate = 0;
+        bool left = false;
+        for (index_type temp = root_; temp != 0;) {
+            parent = temp;
+            left = compare_(value, slots_[temp].key());
+            if (left) {
+                temp = slots_[temp].left;
+            } else {
+                candidate = temp;
+                temp = slots_[temp].right;
+            }
+        }
+        if (candidate != 0 && !compare_(slots_[candidate].key(), value)) {
+            return {const_iterator<TraverseTag::In>(this, candidate), false};
+        }
+        index_type z = acquire(value);
+        slots_[z].parent_color = parent | red_bit;
+        if (parent == 0) {
+            root_ = z;
+        } else if (left) {
+            slots_[parent].left = z;
+        } else {
+            slots_[parent].right = z;
+        }
+        insert_fixup(z);
+
+        return {const_iterator<TraverseTag::In>(this, z), true};
+    }
+
+    const_iterator<TraverseTag::In> insert(const value_type& value) { return insert_check(value).first; }
+
+    template<typename InputIt>
+    void insert(InputIt i, InputIt j) {
+        for (; i != j; ++i) {
+            insert_check(*i);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> il) { insert(il.begin(), il.end()); }
+
+    size_type erase(const value_type& value) {
+        index_type z = exist(value);
+        if (z == 0) {
+            return 0;
+        }
+        erase_slot(z);
+
+        return 1;
+    }
+
+    template<TraverseTag tag>
+    const_iterator<tag> erase(const_iterator<tag> position) {
+        if (position.index_ == 0) {
+            return position;
+        }
+        index_type following = next<tag>(position.index_);
+        erase_slot(position.index_);
+
+        return const_iterator<tag>(this, following);
+    }
+
+    const_iterator<TraverseTag::In> find(const value_type& k) const { return const_iterator<TraverseTag::In>(this, exist(k)); }
+
+    bool contains(const value_type& k) const { return exist(k) != 0; }
+
+    const_iterator<TraverseTag::In> lower_bound(const value_type& k) const {
+        index_type temp = exist(k);
+
+        return const_iterator<TraverseTag::In>(this, temp == 0 ? 0 : prev<TraverseTag::In>(temp));
+    }
+
+    const_iterator<TraverseTag::In> upper_bound(const value_type& k) const {
+        index_type temp = exist(k);
+
+        return const_iterator<TraverseTag::In>(this, temp == 0 ? 0 : next<TraverseTag::In>(temp));
+    }
+
+private:
+    static slot* allocate(size_t n) {
+        return static_cast<slot*>(::operator new(n * sizeof(slot), std::align_val_t(alignof(slot))));
+    }
+
+    static void deallocate(slot* p) {
+        if (p != nullptr) {
+            ::operator delete(p, std::align_val_t(alignof(slot)));
+        }
+    }
+
+    static bool live(index_type i, const slot* slots) { return i != 0 && slots[i].parent_color != free_mark; }
+
+    void destroy_keys() {
+        for (index_type i = 1; i < used_; ++i) {
+            if (live(i, slots_)) {
+                slots_[i].key().~T();
+            }
+        }
+    }
+
+    void grow(size_t n) {
+        if (n > max_nodes) {
+            std::cerr << "..error";
+            std::exit(EXIT_FAILURE);
+        }
+        slot* fresh = allocate(n);
+        for (index_type i = 0; i < used_; ++i) {
+            fresh[i].left = slots_[i].left;
+            fresh[i].right = slots_[i].right;
+            fresh[i].parent_color = slots_[i].parent_color;
+            if (live(i, slots_)) {
+                ::new (static_cast<void*>(fresh[i].storage)) T(std::move(slots_[i].key()));
+                slots_[i].key().~T();
+            }
+        }
+        if (used_ == 0) {
+            fresh[0].left = 0;
+            fresh[0].right = 0;
+            fresh[0].parent_color = 0;
+            used_ = 1;
+        }
+        deallocate(slots_);
+        slots_ = fresh;
+        capacity_ = n;
+    }
+
+    index_type acquire(const value_type& value) {
+        index_type z = free_;
+        if (z != 0) {
+            free_ = slots_[z].left;
+        } else {
+            if (used_ == 0 || used_ == capacity_) {
+                if (used_ == max_nodes) {
+                    std::cerr << "..error";
+                    std::exit(EXIT_FAILURE);
+                }
+                grow(capacity_ < 8 ? 8 : (capacity_ * 2 > max_nodes ? max_nodes : capacity_ * 2));
+            }
+            z = used_++;
+        }
+        ::new (static_cast<void*>(slots_[z].storage)) T(value);
+        slots_[z].left = 0;
+        slots_[z].right = 0;
+        ++size_;
+
+        return z;
+    }
+
+    void release(index_type z) {
+        slots_[z].key().~T();
+        slots_[z].parent_color = free_mark;
+        slots_[z].left = free_;
+        free_ = z;
+        --size_;
+    }
+
+    index_type parent(index_type x) const { return slots_[x].parent_color & ~red_bit; }
+
+    void set_parent(index_type x, index_type p) { slots_[x].parent_color = (slots_[x].parent_color & red_bit) | p; }
+
+    bool is_red(index_type x) const { return (slots_[x].parent_color & red_bit) != 0; }
+
+    void set_red(index_type x, bool red) {
+        slots_[x].parent_color = red ? (slots_[x].parent_color | red_bit) : (slots_[x].parent_color & ~red_bit);
+    }
+
+    void replace_child(index_type p, index_type old_child, index_type new_child) {
+        if (p == 0) {
+            root_ = new_child;
+        } else if (slots_[p].left == old_child) {
+            slots_[p].left = new_child;
+        } else {
+            slots_[p].right = new_child;
+        }
+    }
+
+    void rotate_left(index_type x) {
+        index_type y = slots_[x].right;
+        slots_[x].right = slots_[y].left;
+        if (slots_[y].left != 0) {
+            set_parent(slots_[y].left, x);
+        }
+        set_parent(y, parent(x));
+        replace_child(parent(x), x, y);
+        slots_[y].left = x;
+        set_parent(x, y);
+    }
+
+    void rotate_right(index_type x) {
+        index_type y = slots_[x].left;
+        slots_[x].left = slots_[y].right;
+        if (slots_[y].right != 0) {
+            set_parent(slots_[y].right, x);
+        }
+        set_parent(y, parent(x));
+        replace_child(parent(x), x, y);
+        slots_[y].right = x;
+        set_parent(x, y);
+    }
+
+    void insert_fixup(index_type z) {
+        while (is_red(parent(z))) {
+            index_type p = parent(z);
+            index_type g = parent(p);
+            if (p == slots_[g].left) {
+                index_type uncle = slots_[g].right;
+                if (is_red(uncle)) {
+                    set_red(p, false);
+                    set_red(uncle, false);
+                    set_red(g, true);
+                    z = g;
+                    continue;
+                }
+                if (z == slots_[p].right) {
+                    z = p;
+                    rotate_left(z);
+                    p = parent(z);
+                }
+                set_red(p, false);
+                set_red(g, true);
+                rotate_right(g);
+            } else {
+                index_type uncle = slots_[g].left;
+                if (is_red(uncle)) {
+                    set_red(p, false);
+                    set_red(uncle, false);
+                    set_red(g, true);
+                    z = g;
+                    continue;
+                }
+                if (z == slots_[p].left) {
+                    z = p;
+                    rotate_right(z);
+                    p = parent(z);
+                }
+                set_red(p, false);
+                set_red(g, true);
+                rotate_left(g);
+            }
+        }
+        set_red(root_, false);
+    }
+
+    // v takes u's place under u's parent; slot 0 may receive a parent here, which erase_fixup reads
+    void transplant(index_type u, index_type v) {
+        replace_child(parent(u), u, v);
+        set_parent(v, parent(u));
+    }
+
+    void erase_slot(index_type z) {
+        index_type y = z;
+        bool removed_red = is_red(y);
+        index_type x;
+        if (slots_[z].left == 0) {
+            x = slots_[z].right;
+            transplant(z, x);
+        } else if (slots_[z].right == 0) {
+            x = slots_[z].left;
+            transplant(z, x);
+        } else {
+            y = minimum(slots_[z].right);
+            removed_red = is_red(y);
+            x = slots_[y].right;
+            if (parent(y) == z) {
+                set_parent(x, y);
+            } else {
+                transplant(y, x);
+                slots_[y].right = slots_[z].right;
+                set_parent(slots_[y].right, y);
+            }
+            transplant(z, y);
+            slots_[y].left = slots_[z].left;
+            set_parent(slots_[y].left, y);
+            set_red(y, is_red(z));
+        }
+        if (!removed_red) {
+            erase_fixup(x);
+        }
+        set_red(0, false);
+        set_parent(0, 0);
+        release(z);
+    }
+
+    void erase_fixup(index_type x) {
+        while (x != root_ && !is_red(x)) {
+            index_type p = parent(x);
+            if (x == slots_[p].left) {
+                index_type w = slots_[p].right;
+                if (is_red(w)) {
+                    set_red(w, false);
+                    set_red(p, true);
+                    rotate_left(p);
+                    w = slots_[p].right;
+                }
+                if (!is_red(slots_[w].left) && !is_red(slots_[w].right)) {
+                    set_red(w, true);
+                    x = p;
+                    continue;
+                }
+                if (!is_red(slots_[w].right)) {
+                    set_red(slots_[w].left, false);
+                    set_red(w, true);
+                    rotate_right(w);
+                    w = slots_[p].right;
+                }
+                set_red(w, is_red(p));
+                set_red(p, false);
+                set_red(slots_[w].right, false);
+                rotate_left(p);
+            } else {
+                index_type w = slots_[p].left;
+                if (is_red(w)) {
+                    set_red(w, false);
+                    set_red(p, true);
+                    rotate_right(p);
+                    w = slots_[p].left;
+                }
+                if (!is_red(slots_[w].left) && !is_red(slots_[w].right)) {
+                    set_red(w, true);
+                    x = p;
+                    continue;
+                }
+                if (!is_red(slots_[w].left)) {
+                    set_red(slots_[w].right, false);
+                    set_red(w, true);
+                    rotate_left(w);
+                    w = slots_[p].left;
+                }
+                set_red(w, is_red(p));
+                set_red(p, false);
+                set_red(slots_[w].left, false);
+                rotate_right(p);
+            }
+            x = root_;
+        }
+        set_red(x, false);
+    }
+
+    index_type exist(const value_type& k) const {
+        index_type candidate = 0;
+        index_type temp = root_;
+        while (temp != 0) {
+            if (compare_(slots_[temp].key(), k)) {
+                temp = slots_[temp].right;
+            } else {
+                candidate = temp;
+                temp = slots_[temp].left;
+            }
+        }
+        if (candidate != 0 && !compare_(k, slots_[candidate].key())) {
+            return candidate;
+        }
+
+        return 0;
+    }
+
+    index_type minimum(index_type x) const {
+        while (slots_[x].left != 0) {
+            x = slots_[x].left;
+        }
+
+        return x;
+    }
+
+    index_type maximum(index_type x) const {
+        while (slots_[x].right != 0) {
+            x = slots_[x].right;
+        }
+
+        return x;
+    }
+
+    // deepest node reached by preferring the left child, the first node of a subtree in post-order
+    index_type leftmost_leaf(index_type x) const {
+        while (slots_[x].left != 0 || slots_[x].right != 0) {
+            x = slots_[x].left != 0 ? slots_[x].left : slots_[x].right;
+        }
+
+        return x;
+    }
+
+    // deepest node reached by preferring the right child, the last node of a subtree in pre-order
+    index_type rightmost_leaf(index_type x) const {
+        while (slots_[x].left != 0 || slots_[x].right != 0) {
+            x = slots_[x].right != 0 ? slots_[x].right : slots_[x].left;
+        }
+
+        return x;
+    }
+
+    template<TraverseTag tag>
+    index_type first() const {
+        if (root_ == 0) {
+            return 0;
+        }
+        if (tag == TraverseTag::In) {
+            return minimum(root_);
+        }
+        if (tag == TraverseTag::Post) {
+            return leftmost_leaf(root_);
+        }
+
+        return root_;
+    }
+
+    template<TraverseTag tag>
+    index_type last() const {
+        if (root_ == 0) {
+            return 0;
+        }
+        if (tag == TraverseTag::In) {
+            return maximum(root_);
+        }
+        if (tag == TraverseTag::Pre) {
+            return rightmost_leaf(root_);
+        }
+
+        return root_;
+    }
+
+    template<TraverseTag tag>
+    index_type next(index_type x) const {
+        if (tag == TraverseTag::In) {
+            if (slots_[x].right != 0) {
+                return minimum(slots_[x].right);
+            }
+            index_type p = parent(x);
+            while (p != 0 && x == slots_[p].right) {
+                x = p;
+                p = parent(p);
+            }
+
+            return p;
+        }
+        if (tag == TraverseTag::Pre) {
+            if (slots_[x].left != 0) {
+                return slots_[x].left;
+            }
+            if (slots_[x].right != 0) {
+                return slots_[x].right;
+            }
+            for (index_type p = parent(x); p != 0; x = p, p = parent(p)) {
+                if (x == slots_[p].left && slots_[p].right != 0) {
+                    return slots_[p].right;
+                }
+            }
+
+            return 0;
+        }
+        index_type p = parent(x);
+        if (p == 0 || x == slots_[p].right || slots_[p].right == 0) {
+            return p;
+        }
+
+        return leftmost_leaf(slots_[p].right);
+    }
+
+    template<TraverseTag tag>
+    index_type prev(index_type x) const {
+        if (x == 0) {
+            return last<tag>();
+        }
+        if (tag == TraverseTag::In) {
+            if (slots_[x].left != 0) {
+                return maximum(slots_[x].left);
+            }
+            index_type p = parent(x);
+            while (p != 0 && x == slots_[p].left) {
+                x = p;
+                p = parent(p);
+            }
+
+            return p;
+        }
+        if (tag == TraverseTag::Post) {
+            if (slots_[x].right != 0) {
+                return slots_[x].right;
+            }
+            if (slots_[x].left != 0) {
+                return slots_[x].left;
+            }
+            for (index_type p = parent(x); p != 0; x = p, p = parent(p)) {
+                if (x == slots_[p].right && slots_[p].left != 0) {
+                    return slots_[p].left;
+                }
+            }
+
+            return 0;
+        }
+        index_type p = parent(x);
+        if (p == 0 || x == slots_[p].left || slots_[p].left == 0) {
+            return p;
+        }
+
+        return rightmost_leaf(slots_[p].left);
+    }
+
+    slot* slots_;
+    size_t capacity_;
+    index_type used_;
+    index_type free_;
+    size_type size_;
+    index_type root_;
+    [[no_unique_address]] Compare compare_;
+};
@@ -0,0 +1,334 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+#include "Epoch.h"
+
+// Natarajan-Mittal external BST: keys live in leaves, internal nodes only route, and a deletion
+// first flags the edge to its leaf, then tags the sibling edge and splices both out with one CAS
+template<typename T, typename Compare = std::less<T> >
+class ConcurrentBST {
+    static constexpr uintptr_t flag_bit = 1;
+    static constexpr uintptr_t tag_bit = 2;
+    static constexpr uintptr_t mark_bits = flag_bit | tag_bit;
+
+    struct node : EpochRetired {
+        T key;
+        int sentinel;
+        std::atomic<uintptr_t> left;
+        std::atomic<uintptr_t> right;
+
+        node(const T& k, int s, node* l, node* r)
+            : key(k), sentinel(s), left(reinterpret_cast<uintptr_t>(l)), right(reinterpret_cast<uintptr_t>(r)) {}
+    };
+
+    struct seek_record {
+        node* ancestor;
+        node* successor;
+        node* parent;
+        node* leaf;
+    };
+
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    // visits every key present for the whole walk; keys changed concurrently may or may not show up
+    class const_iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator() : current_(nullptr) {}
+
+        reference operator*() const { return current_->key; }
+        pointer operator->() const { return &current_->key; }
+
+        const_iterator& operator++() {
+            advance();
+
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            advance();
+
+            return temp;
+        }
+
+        bool operator==(const const_iterator& other) const { return current_ == other.current_; }
+        bool operator!=(const const_iterator& other) const { return current_ != other.current_; }
+
+    private:
+        friend class ConcurrentBST;
+
+        explicit const_iterator(node* root) : current_(nullptr) {
+            stack_.push_back(reinterpret_cast<uintptr_t>(root));
+            advance();
+        }
+
+        void advance() {
+            while (!stack_.empty()) {
+                uintptr_t edge = stack_.back();
+                stack_.pop_back();
+                node* x = address(edge);
+                uintptr_t left = x->left.load(std::memory_order_acquire);
+                if (left == 0) {
+                    if ((edge & flag_bit) == 0 && x->sentinel == 0) {
+                        current_ = x;
+                        return;
+                    }
+                    continue;
+                }
+                stack_.push_back(x->right.load(std::memory_order_acquire));
+                stack_.push_back(left);
+            }
+            current_ = nullptr;
+        }
+
+        std::vector<uintptr_t> stack_;
+        node* current_;
+    };
+
+    typedef const_iterator iterator;
+
+    // keeps an epoch pinned so the nodes reached by its iterators stay allocated
+    class view {
+    public:
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator begin() const {
+            static_assert(tag == TraverseTag::In, "ConcurrentBST only iterates in order");
+
+            return const_iterator(root_);
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator end() const {
+            static_assert(tag == TraverseTag::In, "ConcurrentBST only iterates in order");
+
+            return const_iterator();
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cbegin() const { return begin<tag>(); }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cend() const { return end<tag>(); }
+
+    private:
+        friend class ConcurrentBST;
+
+        view(typename EpochDomain<>::Guard guard, node* root) : guard_(std::move(guard)), root_(root) {}
+
+        typename EpochDomain<>::Guard guard_;
+        node* root_;
+    };
+
+    ConcurrentBST() : ConcurrentBST(Compare()) {}
+
+    explicit ConcurrentBST(const Compare& compare) : compare_(compare), size_(0) {
+        node* s = new node(T(), 2, new node(T(), 1, nullptr, nullptr), new node(T(), 2, nullptr, nullptr));
+        root_ = new node(T(), 3, s, new node(T(), 3, nullptr, nullptr));
+    }
+
+    ConcurrentBST(std::initializer_list<value_type> il) : ConcurrentBST() {
+        for (const auto& value : il) {
+            insert(value);
+        }
+    }
+
+    ConcurrentBST(const ConcurrentBST&) = delete;
+    ConcurrentBST& operator=(const ConcurrentBST&) = delete;
+
+    // no other thread may still be using the tree
+    ~ConcurrentBST() {
+        std::vector<node*> stack = {root_};
+        while (!stack.empty()) {
+            node* x = stack.back();
+            stack.pop_back();
+            if (x->left.load() != 0) {
+                stack.push_back(address(x->left.load()));
+                stack.push_back(address(x->right.load()));
+            }
+            delete x;
+        }
+    }
+
+    // approximate while writers are running
+    size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+    key_compare key_comp() const { return compare_; }
+
+    // each live view pins one epoch slot; any number may be held at once, but erased nodes are not freed until
+    // the oldest view is released
+    view read() const { return view(domain_.pin(), root_); }
+
+    bool contains(const value_type& key) const {
+        typename EpochDomain<>::Guard guard = domain_.pin();
+        seek_record s;
+        seek(key, s);
+
+        return equal(s.leaf, key);
+    }
+
+    bool insert(const value_type& key) {
+        typename EpochDomain<>::Guard guard = domain_.pin();
+        node* fresh = nullptr;
+        seek_record s;
+        while (true) {
+            seek(key, s);
+            node* leaf = s.leaf;
+            if (equal(leaf, key)) {
+                delete fresh;
+
+                return false;
+            }
+            if (fresh == nullptr) {
+                fresh = new node(key, 0, nullptr, nullptr);
+            }
+            node* internal = less(key, leaf) ? new node(leaf->key, leaf->sentinel, fresh, leaf)
+                                             : new node(key, 0, leaf, fresh);
+            std::atomic<uintptr_t>& child = less(key, s.parent) ? s.parent->left : s.parent->right;
+            uintptr_t expected = edge(leaf);
+            if (child.compare_exchange_strong(expected, edge(internal))) {
+                size_.fetch_add(1, std::memory_order_relaxed);
+
+                return true;
+            }
+            delete internal;
+            if (address(expected) == leaf && (expected & mark_bits) != 0) {
+                cleanup(key, s);
+            }
+        }
+    }
+
+    size_type erase(const value_type& key) {
+        typename EpochDomain<>::Guard guard = domain_.pin();
+        bool injecting = true;
+        node* leaf = nullptr;
+        seek_record s;
+        while (true) {
+            seek(key, s);
+            if (!injecting) {
+                if (s.leaf != leaf || cleanup(key, s)) {
+                    return 1;
+                }
+                continue;
+            }
+            leaf = s.leaf;
+            if (!equal(leaf, key)) {
+                return 0;
+            }
+            std::atomic<uintptr_t>& child = less(key, s.parent) ? s.parent->left : s.parent->right;
+            uintptr_t expected = edge(leaf);
+            if (child.compare_exchange_strong(expected, edge(leaf) | flag_bit)) {
+                injecting = false;
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                if (cleanup(key, s)) {
+                    return 1;
+                }
+            } else if (address(expected) == leaf && (expected & mark_bits) != 0) {
+                cleanup(key, s);
+            }
+        }
+    }
+
+private:
+    static node* address(uintptr_t e) { return reinterpret_cast<node*>(e & ~mark_bits); }
+
+    static uintptr_t edge(node* x) { return reinterpret_cast<uintptr_t>(x); }
+
+    static void reclaim_node(EpochRetired* p) { delete static_cast<node*>(p); }
+
+    bool less(const value_type& key, const node* x) const { return x->sentinel != 0 || compare_(key, x->key); }
+
+    bool equal(const node* x, const value_type& key) const {
+        return x->sentinel == 0 && !compare_(key, x->key) && !compare_(x->key, key);
+    }
+
+    void seek(const value_type& key, seek_record& s) const {
+        s.ancestor = root_;
+        s.successor = address(root_->left.load());
+        s.parent = s.successor;
+        uintptr_t parent_field = s.parent->left.load();
+        s.leaf = address(parent_field);
+        uintptr_t current_field = s.leaf->left.load();
+        node* current = address(current_field);
+        while (current != nullptr) {
+            if ((parent_field & tag_bit) == 0) {
+                s.ancestor = s.parent;
+                s.successor = s.leaf;
+            }
+            s.parent = s.leaf;
+            s.leaf = current;
+            parent_field = current_field;
+            current_field = less(key, current) ? current->left.load() : current->right.load();
+            current = address(current_field);
+        }
+    }
+
+    bool cleanup(const value_type& key, const seek_record& s) {
+        std::atomic<uintptr_t>& successor_edge = less(key, s.ancestor) ? s.ancestor->left : s.ancestor->right;
+        std::atomic<uintptr_t>* child_edge = &s.parent->right;
+        std::atomic<uintptr_t>* sibling_edge = &s.parent->left;
+        if (less(key, s.parent)) {
+            std::swap(child_edge, sibling_edge);
+        }
+        if ((child_edge->load() & flag_bit) == 0) {
+            sibling_edge = child_edge;
+        }
+        sibling_edge->fetch_or(tag_bit);
+        uintptr_t sibling = sibling_edge->load();
+        uintptr_t expected = edge(s.successor);
+        if (!successor_edge.compare_exchange_strong(expected, sibling & ~tag_bit)) {
+            return false;
+        }
+        retire_chain(key, s.successor, s.parent, address(sibling));
+
+        return true;
+    }
+
+    // the spliced-out chain runs from successor to parent along key; every edge off it is flagged
+    void retire_chain(const value_type& key, node* x, node* parent, node* kept) {
+        while (true) {
+            node* left = address(x->left.load());
+            node* right = address(x->right.load());
+            node* next = x == parent ? kept : (less(key, x) ? left : right);
+            retire(next == left ? right : left);
+            retire(x);
+            if (x == parent) {
+                return;
+            }
+            x = next;
+        }
+    }
+
+    void retire(node* x) {
+        x->reclaim = reclaim_node;
+        domain_.retire(x);
+    }
+
+    mutable EpochDomain<> domain_;
+    [[no_unique_address]] Compare compare_;
+    node* root_;
+    std::atomic<size_type> size_;
+};
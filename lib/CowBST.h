@@ -0,0 +1,257 @@
+#pragma once
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+
+#include "BST.h"
+
+// copies share one BST until a mutating call finds the tree shared and clones it first, so copies that are
+// only read cost O(1); iterators taken before such a call may point into the tree another copy still owns.
+// clones keep the allocator of the tree they copy, so every copy shares it and node handles and merge move
+// freely between copies; with an allocator that is not thread-safe, such as BSTNodePool, copies must then
+// not be written from several threads at once
+template<typename T, typename Allocator = std::allocator<Node<T> >, typename Balance = NoBalancePolicy,
+         typename Compare = std::less<T> >
+class CowBST {
+public:
+    typedef BST<T, Allocator, Balance, Compare> tree_type;
+    typedef T value_type;
+    typedef T key_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef Allocator allocator_type;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef typename tree_type::node_type node_type;
+    typedef typename tree_type::insert_return_type insert_return_type;
+
+    template<TraverseTag tag>
+    using const_iterator = typename tree_type::template const_iterator<tag>;
+
+    template<TraverseTag tag>
+    using const_reverse_iterator = typename tree_type::template const_reverse_iterator<tag>;
+
+    CowBST() : share_(std::make_shared<share>()) {}
+
+    explicit CowBST(const Compare& compare, const Allocator& allocator = Allocator())
+        : share_(std::make_shared<share>(compare, allocator)) {}
+
+    template<typename InputIt>
+    CowBST(InputIt i, InputIt j, const Allocator& allocator = Allocator())
+        : share_(std::make_shared<share>(i, j, allocator)) {}
+
+    CowBST(std::initializer_list<value_type> il, const Allocator& allocator = Allocator())
+        : share_(std::make_shared<share>(il, allocator)) {}
+
+    explicit CowBST(tree_type tree) : share_(std::make_shared<share>(std::move(tree))) {}
+
+    CowBST(const CowBST& other) : share_(other.share_) {
+        share_->owners.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the moved-from copy keeps an empty tree of its own so it stays usable
+    CowBST(CowBST&& other) : share_(std::move(other.share_)) {
+        other.share_ = std::make_shared<share>(share_->tree.key_comp(), share_->tree.get_allocator());
+    }
+
+    ~CowBST() { release(); }
+
+    CowBST& operator=(const CowBST& other) {
+        if (share_ != other.share_) {
+            other.share_->owners.fetch_add(1, std::memory_order_relaxed);
+            release();
+            share_ = other.share_;
+        }
+
+        return *this;
+    }
+
+    CowBST& operator=(CowBST&& other) {
+        if (this != &other) {
+            share_.swap(other.share_);
+        }
+
+        return *this;
+    }
+
+    CowBST& operator=(std::initializer_list<value_type> il) {
+        clear();
+        share_->tree.insert(il);
+
+        return *this;
+    }
+
+    bool operator==(const CowBST& other) const { return share_ == other.share_ || share_->tree == other.share_->tree; }
+
+    bool operator!=(const CowBST& other) const { return !(*this == other); }
+
+    void swap(CowBST& other) { share_.swap(other.share_); }
+
+    // whether another copy still reads the same nodes; a false answer acquires the release of every copy
+    // dropped since, so their reads happen before the writes that follow
+    bool shared() const { return share_->owners.load(std::memory_order_acquire) > 1; }
+
+    const tree_type& tree() const { return share_->tree; }
+
+    allocator_type get_allocator() const { return share_->tree.get_allocator(); }
+
+    key_compare key_comp() const { return share_->tree.key_comp(); }
+
+    value_compare value_comp() const { return share_->tree.key_comp(); }
+
+    size_type size() const { return share_->tree.size(); }
+
+    bool empty() const { return share_->tree.empty(); }
+
+    template<TraverseTag tag>
+    const_iterator<tag> begin() const { return share_->tree.template cbegin<tag>(); }
+
+    template<TraverseTag tag>
+    const_iterator<tag> end() const { return share_->tree.template cend<tag>(); }
+
+    template<TraverseTag tag>
+    const_iterator<tag> cbegin() const { return share_->tree.template cbegin<tag>(); }
+
+    template<TraverseTag tag>
+    const_iterator<tag> cend() const { return share_->tree.template cend<tag>(); }
+
+    template<TraverseTag tag>
+    const_reverse_iterator<tag> crbegin() const { return share_->tree.template crbegin<tag>(); }
+
+    template<TraverseTag tag>
+    const_reverse_iterator<tag> crend() const { return share_->tree.template crend<tag>(); }
+
+    const_iterator<TraverseTag::In> find(const value_type& k) const {
+        return static_cast<const tree_type&>(share_->tree).find(k);
+    }
+
+    const_iterator<TraverseTag::In> lower_bound(const value_type& k) const {
+        return static_cast<const tree_type&>(share_->tree).lower_bound(k);
+    }
+
+    const_iterator<TraverseTag::In> upper_bound(const value_type& k) const {
+        return static_cast<const tree_type&>(share_->tree).upper_bound(k);
+    }
+
+    std::pair<const_iterator<TraverseTag::In>, const_iterator<TraverseTag::In> > equal_range(const value_type& k) const {
+        return static_cast<const tree_type&>(share_->tree).equal_range(k);
+    }
+
+    template<typename Function>
+    void for_each_in_range(const value_type& lo, const value_type& hi, Function f) const {
+        share_->tree.for_each_in_range(lo, hi, f);
+    }
+
+    const_iterator<TraverseTag::In> insert(const value_type& value) {
+        return insert_check(value).first;
+    }
+
+    std::pair<const_iterator<TraverseTag::In>, bool> insert_check(const value_type& value) {
+        if (shared()) {
+            const_iterator<TraverseTag::In> found = find(value);
+            if (found != end<TraverseTag::In>()) {
+                return {found, false};
+            }
+        }
+        auto result = mutable_tree()->insert_check(value);
+
+        return {to_const(result.first), result.second};
+    }
+
+    template<typename... Args>
+    std::pair<const_iterator<TraverseTag::In>, bool> emplace(Args&&... args) {
+        auto result = mutable_tree()->emplace(std::forward<Args>(args)...);
+
+        return {to_const(result.first), result.second};
+    }
+
+    void insert(std::initializer_list<value_type> il) { mutable_tree()->insert(il); }
+
+    template<typename InputIt>
+    void insert(InputIt i, InputIt j) { mutable_tree()->insert(i, j); }
+
+    insert_return_type insert(node_type&& handle) { return mutable_tree()->insert(std::move(handle)); }
+
+    size_type erase(const value_type& value) {
+        if (shared() && find(value) == end<TraverseTag::In>()) {
+            return 0;
+        }
+
+        return mutable_tree()->erase(value);
+    }
+
+    // a position in a shared tree is carried over to the clone by its key
+    const_iterator<TraverseTag::In> erase(const_iterator<TraverseTag::In> position) {
+        if (position == end<TraverseTag::In>()) {
+            return position;
+        }
+        if (shared()) {
+            value_type key = *position;
+            position = static_cast<const tree_type&>(*mutable_tree()).find(key);
+        }
+
+        return share_->tree.erase(position);
+    }
+
+    node_type extract(const value_type& value) {
+        if (shared() && find(value) == end<TraverseTag::In>()) {
+            return node_type();
+        }
+
+        return mutable_tree()->extract(value);
+    }
+
+    void merge(CowBST& other) {
+        if (share_ == other.share_ || other.empty()) {
+            return;
+        }
+        mutable_tree()->merge(*other.mutable_tree());
+    }
+
+    void clear() {
+        if (shared()) {
+            std::shared_ptr<share> fresh =
+                std::make_shared<share>(share_->tree.key_comp(), share_->tree.get_allocator());
+            release();
+            share_ = std::move(fresh);
+            return;
+        }
+        share_->tree.clear();
+    }
+
+private:
+    tree_type* mutable_tree() {
+        // copy-assigning into a tree built with our allocator keeps it, where the copy constructor would ask
+        // select_on_container_copy_construction for a fresh one
+        if (shared()) {
+            std::shared_ptr<share> clone =
+                std::make_shared<share>(share_->tree.key_comp(), share_->tree.get_allocator());
+            clone->tree = share_->tree;
+            release();
+            share_ = std::move(clone);
+        }
+
+        return &share_->tree;
+    }
+
+    // the release pairs with the acquire in shared(), ordering this copy's reads before another copy's writes
+    void release() { share_->owners.fetch_sub(1, std::memory_order_release); }
+
+    static const_iterator<TraverseTag::In> to_const(typename tree_type::template iterator<TraverseTag::In> it) {
+        return const_iterator<TraverseTag::In>(it.operator->());
+    }
+
+    // shared_ptr::use_count is a relaxed load and cannot order anything, so ownership is counted separately
+    struct share {
+        template<typename... Args>
+        explicit share(Args&&... args) : tree(std::forward<Args>(args)...) {}
+
+        tree_type tree;
+        std::atomic<size_t> owners{1};
+    };
+
+    std::shared_ptr<share> share_;
+};
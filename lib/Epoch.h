@@ -0,0 +1,175 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <thread>
+
+struct EpochRetired {
+    EpochRetired* retired_next = nullptr;
+    uint64_t retired_epoch = 0;
+    void (*reclaim)(EpochRetired*) = nullptr;
+};
+
+template<size_t Slots = 128>
+class EpochDomain {
+public:
+    class Guard {
+    public:
+        Guard() : slot_(nullptr) {}
+
+        Guard(Guard&& other) noexcept : slot_(other.slot_) { other.slot_ = nullptr; }
+
+        Guard& operator=(Guard&& other) noexcept {
+            if (this != &other) {
+                unpin();
+                slot_ = other.slot_;
+                other.slot_ = nullptr;
+            }
+
+            return *this;
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() { unpin(); }
+
+        void unpin() {
+            if (slot_ != nullptr) {
+                slot_->store(0, std::memory_order_release);
+                slot_ = nullptr;
+            }
+        }
+
+    private:
+        friend class EpochDomain;
+
+        explicit Guard(std::atomic<uint64_t>* slot) : slot_(slot) {}
+
+        std::atomic<uint64_t>* slot_;
+    };
+
+    EpochDomain() : epoch_(1), retired_(nullptr), pending_(0), reclaiming_(false) {}
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // no thread may still be pinned
+    ~EpochDomain() {
+        destroy(retired_.exchange(nullptr));
+        Block* block = head_.next.load();
+        while (block != nullptr) {
+            Block* next = block->next.load();
+            delete block;
+            block = next;
+        }
+    }
+
+    // everything reachable from shared pointers loaded after pin() stays alive until the guard is released;
+    // every live guard holds one slot, and when all are taken the domain chains another block of Slots slots,
+    // so pin() never waits (blocks are kept until the domain is destroyed)
+    Guard pin() {
+        size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % Slots;
+        uint64_t epoch = epoch_.load();
+        for (Block* block = &head_;;) {
+            for (size_t i = 0; i < Slots; ++i) {
+                std::atomic<uint64_t>& slot = block->slots[(start + i) % Slots].epoch;
+                uint64_t expected = 0;
+                if (slot.load(std::memory_order_relaxed) == 0 && slot.compare_exchange_strong(expected, epoch)) {
+                    return Guard(&slot);
+                }
+            }
+            Block* next = block->next.load();
+            if (next == nullptr) {
+                Block* fresh = new Block();
+                if (block->next.compare_exchange_strong(next, fresh)) {
+                    next = fresh;
+                } else {
+                    delete fresh;
+                }
+            }
+            block = next;
+        }
+    }
+
+    // p must already be unreachable for readers that pin from now on
+    void retire(EpochRetired* p) {
+        p->retired_epoch = epoch_.load();
+        push(p, p);
+        if (pending_.fetch_add(1, std::memory_order_relaxed) + 1 >= reclaim_batch) {
+            reclaim();
+        }
+    }
+
+    void reclaim() {
+        if (reclaiming_.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+        pending_.store(0, std::memory_order_relaxed);
+        epoch_.fetch_add(1);
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        for (Block* block = &head_; block != nullptr; block = block->next.load()) {
+            for (Slot& slot : block->slots) {
+                uint64_t epoch = slot.epoch.load();
+                if (epoch != 0 && epoch < oldest) {
+                    oldest = epoch;
+                }
+            }
+        }
+        EpochRetired* keep_head = nullptr;
+        EpochRetired* keep_tail = nullptr;
+        EpochRetired* list = retired_.exchange(nullptr);
+        while (list != nullptr) {
+            EpochRetired* next = list->retired_next;
+            if (list->retired_epoch < oldest) {
+                list->reclaim(list);
+            } else {
+                list->retired_next = keep_head;
+                keep_head = list;
+                if (keep_tail == nullptr) {
+                    keep_tail = list;
+                }
+            }
+            list = next;
+        }
+        if (keep_head != nullptr) {
+            push(keep_head, keep_tail);
+        }
+        reclaiming_.store(false, std::memory_order_release);
+    }
+
+private:
+    static constexpr size_t reclaim_batch = 256;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    struct Block {
+        Slot slots[Slots];
+        std::atomic<Block*> next{nullptr};
+    };
+
+    void push(EpochRetired* head, EpochRetired* tail) {
+        EpochRetired* old = retired_.load(std::memory_order_relaxed);
+        do {
+            tail->retired_next = old;
+        } while (!retired_.compare_exchange_weak(old, head, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static void destroy(EpochRetired* list) {
+        while (list != nullptr) {
+            EpochRetired* next = list->retired_next;
+            list->reclaim(list);
+            list = next;
+        }
+    }
+
+    Block head_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<EpochRetired*> retired_;
+    std::atomic<size_t> pending_;
+    std::atomic<bool> reclaiming_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+
+// 1-based BFS indices of an implicit complete tree with n nodes: node k has children 2k and 2k + 1, and 0 is
+// the position past either end of the in-order sequence
+struct Eytzinger {
+    static size_t first(size_t n) {
+        if (n == 0) {
+            return 0;
+        }
+        size_t index = 1;
+        while (2 * index <= n) {
+            index *= 2;
+        }
+
+        return index;
+    }
+
+    static size_t last(size_t n) {
+        if (n == 0) {
+            return 0;
+        }
+        size_t index = 1;
+        while (2 * index + 1 <= n) {
+            index = 2 * index + 1;
+        }
+
+        return index;
+    }
+
+    static size_t next(size_t index, size_t n) {
+        if (2 * index + 1 <= n) {
+            index = 2 * index + 1;
+            while (2 * index <= n) {
+                index *= 2;
+            }
+
+            return index;
+        }
+
+        return index >> (std::countr_one(index) + 1);
+    }
+
+    static size_t prev(size_t index, size_t n) {
+        if (2 * index <= n) {
+            index = 2 * index;
+            while (2 * index + 1 <= n) {
+                index = 2 * index + 1;
+            }
+
+            return index;
+        }
+
+        return index >> (std::countr_zero(index) + 1);
+    }
+};
@@ -0,0 +1,247 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "BST.h"
+#include "Eytzinger.h"
+
+// read-only search and in-order iteration over keys stored in Eytzinger order; the storage belongs to the
+// derived class, which points data_ at it
+template<typename T, typename Compare = std::less<T> >
+class EytzingerView {
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator() : tree_(nullptr), index_(0) {}
+
+        reference operator*() const { return tree_->data_[index_ - 1]; }
+        pointer operator->() const { return &tree_->data_[index_ - 1]; }
+
+        const_iterator& operator++() {
+            index_ = Eytzinger::next(index_, tree_->size_);
+
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+
+            return temp;
+        }
+
+        const_iterator& operator--() {
+            size_type n = tree_->size_;
+            index_ = index_ == 0 ? Eytzinger::last(n) : Eytzinger::prev(index_, n);
+
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator temp = *this;
+            --*this;
+
+            return temp;
+        }
+
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        friend class EytzingerView;
+
+        const_iterator(const EytzingerView* tree, size_type index) : tree_(tree), index_(index) {}
+
+        const EytzingerView* tree_;
+        size_type index_;
+    };
+
+    typedef const_iterator iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+    typedef const_reverse_iterator reverse_iterator;
+
+    size_type size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    key_compare key_comp() const { return compare_; }
+
+    value_compare value_comp() const { return compare_; }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator begin() const {
+        static_assert(tag == TraverseTag::In, "Eytzinger layouts only keep the in-order sequence");
+
+        return const_iterator(this, Eytzinger::first(size_));
+    }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator end() const {
+        static_assert(tag == TraverseTag::In, "Eytzinger layouts only keep the in-order sequence");
+
+        return const_iterator(this, 0);
+    }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator cbegin() const { return begin<tag>(); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator cend() const { return end<tag>(); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end<tag>()); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin<tag>()); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_reverse_iterator crbegin() const { return rbegin<tag>(); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_reverse_iterator crend() const { return rend<tag>(); }
+
+    const_iterator find(const value_type& k) const { return const_iterator(this, exist_index(k)); }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const_iterator find(const K& k) const { return const_iterator(this, exist_index(k)); }
+
+    bool contains(const value_type& k) const { return exist_index(k) != 0; }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K& k) const { return exist_index(k) != 0; }
+
+    const_iterator lower_bound(const value_type& k) const { return const_iterator(this, lower_index(k)); }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const_iterator lower_bound(const K& k) const { return const_iterator(this, lower_index(k)); }
+
+    const_iterator upper_bound(const value_type& k) const { return const_iterator(this, upper_index(k)); }
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    const_iterator upper_bound(const K& k) const { return const_iterator(this, upper_index(k)); }
+
+protected:
+    EytzingerView(const T* data, size_type size, const Compare& compare) : data_(data), size_(size), compare_(compare) {}
+
+    const T* data_;
+    size_type size_;
+    [[no_unique_address]] Compare compare_;
+
+private:
+    // data_[k - 1] holds the node with 1-based BFS index k; its children live at 2k and 2k + 1
+    template<typename K>
+    size_type first_not_less(const K& k) const {
+        const T* base = data_;
+        size_type n = size_;
+        size_type index = 1;
+        while (index <= n) {
+#if defined(__GNUC__)
+            __builtin_prefetch(base + std::min(16 * index, n) - 1);
+#endif
+            index = 2 * index + static_cast<size_type>(compare_(base[index - 1], k));
+        }
+
+        return index >> (std::countr_one(index) + 1);
+    }
+
+    template<typename K>
+    size_type exist_index(const K& k) const {
+        size_type index = first_not_less(k);
+        if (index != 0 && compare_(k, data_[index - 1])) {
+            return 0;
+        }
+
+        return index;
+    }
+
+    template<typename K>
+    size_type lower_index(const K& k) const {
+        size_type index = exist_index(k);
+
+        return index == 0 ? 0 : Eytzinger::prev(index, size_);
+    }
+
+    template<typename K>
+    size_type upper_index(const K& k) const {
+        size_type index = exist_index(k);
+
+        return index == 0 ? 0 : Eytzinger::next(index, size_);
+    }
+};
+
+template<typename T, typename Compare = std::less<T> >
+class FrozenBST : public EytzingerView<T, Compare> {
+    typedef EytzingerView<T, Compare> view_type;
+
+public:
+    typedef typename view_type::size_type size_type;
+
+    FrozenBST() : view_type(nullptr, 0, Compare()), keys_() {}
+
+    template<typename Allocator, typename Balance>
+    explicit FrozenBST(const BST<T, Allocator, Balance, Compare>& tree) : view_type(nullptr, 0, tree.key_comp()), keys_() {
+        size_type n = tree.size();
+        std::vector<const T*> slots(n);
+        size_type k = Eytzinger::first(n);
+        for (auto it = tree.template cbegin<TraverseTag::In>(); it != tree.template cend<TraverseTag::In>(); ++it) {
+            slots[k - 1] = &*it;
+            k = Eytzinger::next(k, n);
+        }
+        keys_.reserve(n);
+        for (const T* key : slots) {
+            keys_.push_back(*key);
+        }
+        attach();
+    }
+
+    FrozenBST(const FrozenBST& other) : view_type(other), keys_(other.keys_) { attach(); }
+
+    FrozenBST(FrozenBST&& other) noexcept : view_type(other), keys_(std::move(other.keys_)) {
+        attach();
+        other.attach();
+    }
+
+    FrozenBST& operator=(const FrozenBST& other) {
+        keys_ = other.keys_;
+        this->compare_ = other.compare_;
+        attach();
+
+        return *this;
+    }
+
+    FrozenBST& operator=(FrozenBST&& other) noexcept {
+        keys_ = std::move(other.keys_);
+        this->compare_ = other.compare_;
+        attach();
+        other.attach();
+
+        return *this;
+    }
+
+private:
+    void attach() {
+        this->data_ = keys_.data();
+        this->size_ = keys_.size();
+    }
+
+    std::vector<T> keys_;
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <new>
+#endif
+
+#include "BSTImage.h"
+#include "FrozenBST.h"
+
+// serves lookups and in-order iteration straight from an image written by BST::save; the keys are never copied,
+// and Compare must order them the same way the saved tree did
+template<typename T, typename Compare = std::less<T> >
+class MappedBST : public EytzingerView<T, Compare> {
+    static_assert(std::is_trivially_copyable_v<T>, "MappedBST keys are read from the file as raw bytes");
+
+    typedef EytzingerView<T, Compare> view_type;
+
+public:
+    typedef typename view_type::size_type size_type;
+
+    // empty if the file cannot be read, was written for another key type or byte order, or fails the checksum;
+    // verify = false skips the checksum, so only the pages that lookups touch get faulted in
+    static std::optional<MappedBST> open(const std::string& path, bool verify = true,
+                                         const Compare& compare = Compare()) {
+        size_t bytes = 0;
+        void* mapping = map_file(path, bytes);
+        if (mapping == nullptr) {
+            return std::nullopt;
+        }
+        MappedBST tree(mapping, bytes, compare);
+        if (bytes < BSTImageHeader::keys_offset) {
+            return std::nullopt;
+        }
+        BSTImageHeader header;
+        std::memcpy(&header, mapping, sizeof(header));
+        size_t key_bytes = bytes - BSTImageHeader::keys_offset;
+        if (!header.template matches<T>() || key_bytes % sizeof(T) != 0 || key_bytes / sizeof(T) != header.count) {
+            return std::nullopt;
+        }
+        const char* keys = static_cast<const char*>(mapping) + BSTImageHeader::keys_offset;
+        if (verify && BSTImageHeader::checksum_of(keys, key_bytes) != header.checksum) {
+            return std::nullopt;
+        }
+        tree.data_ = reinterpret_cast<const T*>(keys);
+        tree.size_ = header.count;
+
+        return std::optional<MappedBST>(std::move(tree));
+    }
+
+    MappedBST(const MappedBST&) = delete;
+    MappedBST& operator=(const MappedBST&) = delete;
+
+    MappedBST(MappedBST&& other) noexcept : view_type(other), mapping_(other.mapping_), bytes_(other.bytes_) {
+        other.release();
+    }
+
+    MappedBST& operator=(MappedBST&& other) noexcept {
+        if (this != &other) {
+            unmap_file(mapping_, bytes_);
+            view_type::operator=(other);
+            mapping_ = other.mapping_;
+            bytes_ = other.bytes_;
+            other.release();
+        }
+
+        return *this;
+    }
+
+    ~MappedBST() { unmap_file(mapping_, bytes_); }
+
+private:
+    MappedBST(void* mapping, size_t bytes, const Compare& compare)
+        : view_type(nullptr, 0, compare), mapping_(mapping), bytes_(bytes) {}
+
+    void release() {
+        this->data_ = nullptr;
+        this->size_ = 0;
+        mapping_ = nullptr;
+        bytes_ = 0;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    static void* map_file(const std::string& path, size_t& bytes) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        bytes = static_cast<size_t>(info.st_size);
+        void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        return mapping == MAP_FAILED ? nullptr : mapping;
+    }
+
+    static void unmap_file(void* mapping, size_t bytes) {
+        if (mapping != nullptr) {
+            ::munmap(mapping, bytes);
+        }
+    }
+#else
+    // without mmap the image is read into one aligned buffer, which still needs no parsing
+    static void* map_file(const std::string& path, size_t& bytes) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in || in.tellg() <= 0) {
+            return nullptr;
+        }
+        bytes = static_cast<size_t>(in.tellg());
+        void* buffer = ::operator new(bytes, std::align_val_t(BSTImageHeader::keys_offset));
+        in.seekg(0);
+        if (!in.read(static_cast<char*>(buffer), static_cast<std::streamsize>(bytes))) {
+            ::operator delete(buffer, std::align_val_t(BSTImageHeader::keys_offset));
+            return nullptr;
+        }
+
+        return buffer;
+    }
+
+    static void unmap_file(void* mapping, size_t) {
+        if (mapping != nullptr) {
+            ::operator delete(mapping, std::align_val_t(BSTImageHeader::keys_offset));
+        }
+    }
+#endif
+
+    void* mapping_;
+    size_t bytes_;
+};
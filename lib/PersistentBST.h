@@ -0,0 +1,445 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+#include "BST.h"
+
+// path-copying AVL tree: insert and erase rebuild only the nodes on the search path, every other subtree is
+// shared between versions and freed once the last version that reaches it is gone
+template<typename T, typename Compare = std::less<T> >
+class PersistentBST {
+    struct node {
+        T key;
+        const node* left;
+        const node* right;
+        int height;
+        mutable std::atomic<size_t> refs;
+
+        node(const T& k, const node* l, const node* r) : key(k), left(l), right(r), height(1), refs(1) {}
+    };
+
+    static constexpr size_t max_height = 96;
+
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator() : root_(nullptr), depth_(0) {}
+
+        reference operator*() const { return path_[depth_ - 1]->key; }
+        pointer operator->() const { return &path_[depth_ - 1]->key; }
+
+        const_iterator& operator++() {
+            const node* x = path_[depth_ - 1];
+            if (x->right != nullptr) {
+                push_leftmost(x->right);
+            } else {
+                --depth_;
+                while (depth_ != 0 && path_[depth_ - 1]->right == x) {
+                    x = path_[--depth_];
+                }
+            }
+
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+
+            return temp;
+        }
+
+        const_iterator& operator--() {
+            if (depth_ == 0) {
+                push_rightmost(root_);
+                return *this;
+            }
+            const node* x = path_[depth_ - 1];
+            if (x->left != nullptr) {
+                push_rightmost(x->left);
+            } else {
+                --depth_;
+                while (depth_ != 0 && path_[depth_ - 1]->left == x) {
+                    x = path_[--depth_];
+                }
+            }
+
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator temp = *this;
+            --*this;
+
+            return temp;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return depth_ == other.depth_ && (depth_ == 0 || path_[depth_ - 1] == other.path_[depth_ - 1]);
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PersistentBST;
+
+        explicit const_iterator(const node* root) : root_(root), depth_(0) {}
+
+        void push_leftmost(const node* x) {
+            for (; x != nullptr; x = x->left) {
+                path_[depth_++] = x;
+            }
+        }
+
+        void push_rightmost(const node* x) {
+            for (; x != nullptr; x = x->right) {
+                path_[depth_++] = x;
+            }
+        }
+
+        const node* root_;
+        const node* path_[max_height];
+        size_t depth_;
+    };
+
+    typedef const_iterator iterator;
+
+    // an immutable version of the set; copying one only bumps the reference count of its root
+    class version {
+    public:
+        version() : root_(nullptr), size_(0), compare_() {}
+
+        version(const version& other) : root_(retain(other.root_)), size_(other.size_), compare_(other.compare_) {}
+
+        version(version&& other) noexcept : root_(other.root_), size_(other.size_), compare_(other.compare_) {
+            other.root_ = nullptr;
+            other.size_ = 0;
+        }
+
+        version& operator=(version other) noexcept {
+            std::swap(root_, other.root_);
+            std::swap(size_, other.size_);
+            std::swap(compare_, other.compare_);
+
+            return *this;
+        }
+
+        ~version() { release(root_); }
+
+        size_type size() const { return size_; }
+
+        bool empty() const { return size_ == 0; }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator begin() const {
+            static_assert(tag == TraverseTag::In, "PersistentBST versions only iterate in order");
+            const_iterator it(root_);
+            it.push_leftmost(root_);
+
+            return it;
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator end() const {
+            static_assert(tag == TraverseTag::In, "PersistentBST versions only iterate in order");
+
+            return const_iterator(root_);
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cbegin() const { return begin<tag>(); }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cend() const { return end<tag>(); }
+
+        bool contains(const value_type& k) const { return find(k) != end(); }
+
+        const_iterator find(const value_type& k) const {
+            const_iterator it = first_not_less(k);
+            if (it.depth_ != 0 && compare_(k, *it)) {
+                return end();
+            }
+
+            return it;
+        }
+
+        const_iterator lower_bound(const value_type& k) const {
+            const_iterator it = find(k);
+            if (it == end() || it == begin()) {
+                return end();
+            }
+
+            return --it;
+        }
+
+        const_iterator upper_bound(const value_type& k) const {
+            const_iterator it = find(k);
+            if (it == end()) {
+                return it;
+            }
+
+            return ++it;
+        }
+
+    private:
+        friend class PersistentBST;
+
+        explicit version(const Compare& compare) : root_(nullptr), size_(0), compare_(compare) {}
+
+        const_iterator first_not_less(const value_type& k) const {
+            const_iterator it(root_);
+            size_t candidate = 0;
+            for (const node* temp = root_; temp != nullptr;) {
+                it.path_[it.depth_++] = temp;
+                if (compare_(temp->key, k)) {
+                    temp = temp->right;
+                } else {
+                    candidate = it.depth_;
+                    temp = temp->left;
+                }
+            }
+            it.depth_ = candidate;
+
+            return it;
+        }
+
+        const node* root_;
+        size_type size_;
+        [[no_unique_address]] Compare compare_;
+    };
+
+    PersistentBST() : current_() {}
+
+    explicit PersistentBST(const Compare& compare) : current_(compare) {}
+
+    PersistentBST(std::initializer_list<value_type> il) : current_() {
+        for (const auto& value : il) {
+            insert(value);
+        }
+    }
+
+    // the copy shares every node with this tree until one of them changes
+    PersistentBST(const PersistentBST& other) = default;
+    PersistentBST(PersistentBST&& other) noexcept = default;
+    PersistentBST& operator=(const PersistentBST& other) = default;
+    PersistentBST& operator=(PersistentBST&& other) noexcept = default;
+
+    version snapshot() const { return current_; }
+
+    size_type size() const { return current_.size(); }
+
+    bool empty() const { return current_.empty(); }
+
+    key_compare key_comp() const { return current_.compare_; }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator begin() const { return current_.template begin<tag>(); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator end() const { return current_.template end<tag>(); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator cbegin() const { return current_.template cbegin<tag>(); }
+
+    template<TraverseTag tag = TraverseTag::In>
+    const_iterator cend() const { return current_.template cend<tag>(); }
+
+    bool contains(const value_type& k) const { return current_.contains(k); }
+
+    const_iterator find(const value_type& k) const { return current_.find(k); }
+
+    const_iterator lower_bound(const value_type& k) const { return current_.lower_bound(k); }
+
+    const_iterator upper_bound(const value_type& k) const { return current_.upper_bound(k); }
+
+    bool insert(const value_type& value) {
+        bool inserted = false;
+        const node* root = insert_node(current_.root_, value, inserted);
+        if (!inserted) {
+            release(root);
+
+            return false;
+        }
+        replace_root(root, current_.size_ + 1);
+
+        return true;
+    }
+
+    size_type erase(const value_type& value) {
+        bool erased = false;
+        const node* root = erase_node(current_.root_, value, erased);
+        if (!erased) {
+            release(root);
+
+            return 0;
+        }
+        replace_root(root, current_.size_ - 1);
+
+        return 1;
+    }
+
+    void clear() { replace_root(nullptr, 0); }
+
+private:
+    // every function below returns a node the caller owns one reference to, and only borrows its arguments
+    static const node* retain(const node* x) {
+        if (x != nullptr) {
+            x->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return x;
+    }
+
+    static void release(const node* x) {
+        while (x != nullptr && x->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            const node* left = x->left;
+            const node* right = x->right;
+            delete x;
+            release(left);
+            x = right;
+        }
+    }
+
+    static int height(const node* x) { return x == nullptr ? 0 : x->height; }
+
+    static const node* make(const T& key, const node* left, const node* right) {
+        node* x = new node(key, retain(left), retain(right));
+        int l = height(left);
+        int r = height(right);
+        x->height = 1 + (l > r ? l : r);
+
+        return x;
+    }
+
+    // builds key with children left and right, rotating once or twice if their heights differ by two
+    static const node* balance(const T& key, const node* left, const node* right) {
+        int diff = height(left) - height(right);
+        if (diff > 1) {
+            if (height(left->left) >= height(left->right)) {
+                const node* lower = make(key, left->right, right);
+                const node* result = make(left->key, left->left, lower);
+                release(lower);
+
+                return result;
+            }
+            const node* pivot = left->right;
+            const node* lower_left = make(left->key, left->left, pivot->left);
+            const node* lower_right = make(key, pivot->right, right);
+            const node* result = make(pivot->key, lower_left, lower_right);
+            release(lower_left);
+            release(lower_right);
+
+            return result;
+        }
+        if (diff < -1) {
+            if (height(right->right) >= height(right->left)) {
+                const node* lower = make(key, left, right->left);
+                const node* result = make(right->key, lower, right->right);
+                release(lower);
+
+                return result;
+            }
+            const node* pivot = right->left;
+            const node* lower_left = make(key, left, pivot->left);
+            const node* lower_right = make(right->key, pivot->right, right->right);
+            const node* result = make(pivot->key, lower_left, lower_right);
+            release(lower_left);
+            release(lower_right);
+
+            return result;
+        }
+
+        return make(key, left, right);
+    }
+
+    const node* insert_node(const node* t, const value_type& value, bool& inserted) const {
+        if (t == nullptr) {
+            inserted = true;
+
+            return make(value, nullptr, nullptr);
+        }
+        bool go_left = current_.compare_(value, t->key);
+        if (!go_left && !current_.compare_(t->key, value)) {
+            return retain(t);
+        }
+        const node* child = insert_node(go_left ? t->left : t->right, value, inserted);
+        if (!inserted) {
+            release(child);
+
+            return retain(t);
+        }
+        const node* result = go_left ? balance(t->key, child, t->right) : balance(t->key, t->left, child);
+        release(child);
+
+        return result;
+    }
+
+    static const node* erase_min(const node* t, const node*& minimum) {
+        if (t->left == nullptr) {
+            minimum = t;
+
+            return retain(t->right);
+        }
+        const node* left = erase_min(t->left, minimum);
+        const node* result = balance(t->key, left, t->right);
+        release(left);
+
+        return result;
+    }
+
+    const node* erase_node(const node* t, const value_type& value, bool& erased) const {
+        if (t == nullptr) {
+            return nullptr;
+        }
+        bool go_left = current_.compare_(value, t->key);
+        if (go_left || current_.compare_(t->key, value)) {
+            const node* child = erase_node(go_left ? t->left : t->right, value, erased);
+            if (!erased) {
+                release(child);
+
+                return retain(t);
+            }
+            const node* result = go_left ? balance(t->key, child, t->right) : balance(t->key, t->left, child);
+            release(child);
+
+            return result;
+        }
+        erased = true;
+        if (t->left == nullptr || t->right == nullptr) {
+            return retain(t->left != nullptr ? t->left : t->right);
+        }
+        const node* minimum;
+        const node* right = erase_min(t->right, minimum);
+        const node* result = balance(minimum->key, t->left, right);
+        release(right);
+
+        return result;
+    }
+
+    void replace_root(const node* root, size_type size) {
+        release(current_.root_);
+        current_.root_ = root;
+        current_.size_ = size;
+    }
+
+    version current_;
+};
@@ -0,0 +1,476 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+#include "Epoch.h"
+
+template<typename T, typename Compare = std::less<T> >
+class RcuBST {
+    struct node : EpochRetired {
+        T key;
+        const node* left;
+        const node* right;
+        int height;
+        uint64_t version;
+
+        node(const T& k, const node* l, const node* r, uint64_t v) : key(k), left(l), right(r), height(1), version(v) {}
+    };
+
+    struct state : EpochRetired {
+        const node* root;
+        size_t size;
+
+        state(const node* r, size_t s) : root(r), size(s) {}
+    };
+
+    static constexpr size_t max_height = 96;
+
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator() : root_(nullptr), depth_(0) {}
+
+        reference operator*() const { return path_[depth_ - 1]->key; }
+        pointer operator->() const { return &path_[depth_ - 1]->key; }
+
+        const_iterator& operator++() {
+            const node* x = path_[depth_ - 1];
+            if (x->right != nullptr) {
+                push_leftmost(x->right);
+            } else {
+                --depth_;
+                while (depth_ != 0 && path_[depth_ - 1]->right == x) {
+                    x = path_[--depth_];
+                }
+            }
+
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+
+            return temp;
+        }
+
+        const_iterator& operator--() {
+            if (depth_ == 0) {
+                push_rightmost(root_);
+                return *this;
+            }
+            const node* x = path_[depth_ - 1];
+            if (x->left != nullptr) {
+                push_rightmost(x->left);
+            } else {
+                --depth_;
+                while (depth_ != 0 && path_[depth_ - 1]->left == x) {
+                    x = path_[--depth_];
+                }
+            }
+
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator temp = *this;
+            --*this;
+
+            return temp;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return depth_ == other.depth_ && (depth_ == 0 || path_[depth_ - 1] == other.path_[depth_ - 1]);
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class RcuBST;
+
+        explicit const_iterator(const node* root) : root_(root), depth_(0) {}
+
+        void push_leftmost(const node* x) {
+            for (; x != nullptr; x = x->left) {
+                path_[depth_++] = x;
+            }
+        }
+
+        void push_rightmost(const node* x) {
+            for (; x != nullptr; x = x->right) {
+                path_[depth_++] = x;
+            }
+        }
+
+        const node* root_;
+        const node* path_[max_height];
+        size_t depth_;
+    };
+
+    typedef const_iterator iterator;
+
+    // a consistent version of the tree that stays readable while the guard is held
+    class snapshot {
+    public:
+        size_type size() const { return state_->size; }
+
+        bool empty() const { return state_->size == 0; }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator begin() const {
+            static_assert(tag == TraverseTag::In, "RcuBST snapshots only iterate in order");
+            const_iterator it(state_->root);
+            it.push_leftmost(state_->root);
+
+            return it;
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator end() const {
+            static_assert(tag == TraverseTag::In, "RcuBST snapshots only iterate in order");
+
+            return const_iterator(state_->root);
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cbegin() const { return begin<tag>(); }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cend() const { return end<tag>(); }
+
+        bool contains(const value_type& k) const { return find(k) != end(); }
+
+        const_iterator find(const value_type& k) const {
+            const_iterator it = first_not_less(k);
+            if (it.depth_ != 0 && tree_->compare_(k, *it)) {
+                return end();
+            }
+
+            return it;
+        }
+
+        const_iterator lower_bound(const value_type& k) const {
+            const_iterator it = find(k);
+            if (it == end() || it == begin()) {
+                return end();
+            }
+
+            return --it;
+        }
+
+        const_iterator upper_bound(const value_type& k) const {
+            const_iterator it = find(k);
+            if (it == end()) {
+                return it;
+            }
+
+            return ++it;
+        }
+
+    private:
+        friend class RcuBST;
+
+        snapshot(const RcuBST* tree, typename EpochDomain<>::Guard guard, const state* s)
+            : tree_(tree), guard_(std::move(guard)), state_(s) {}
+
+        const_iterator first_not_less(const value_type& k) const {
+            const_iterator it(state_->root);
+            size_t candidate = 0;
+            for (const node* temp = state_->root; temp != nullptr;) {
+                it.path_[it.depth_++] = temp;
+                if (tree_->compare_(temp->key, k)) {
+                    temp = temp->right;
+                } else {
+                    candidate = it.depth_;
+                    temp = temp->left;
+                }
+            }
+            it.depth_ = candidate;
+
+            return it;
+        }
+
+        const RcuBST* tree_;
+        typename EpochDomain<>::Guard guard_;
+        const state* state_;
+    };
+
+    RcuBST() : compare_(), current_(new state(nullptr, 0)), size_(0), version_(0) {}
+
+    explicit RcuBST(const Compare& compare) : compare_(compare), current_(new state(nullptr, 0)), size_(0), version_(0) {}
+
+    RcuBST(std::initializer_list<value_type> il) : RcuBST() {
+        for (const auto& value : il) {
+            insert(value);
+        }
+    }
+
+    RcuBST(const RcuBST&) = delete;
+    RcuBST& operator=(const RcuBST&) = delete;
+
+    // no reader may still hold a snapshot
+    ~RcuBST() {
+        const state* s = current_.load();
+        destroy(s->root);
+        delete s;
+    }
+
+    // each live snapshot pins one epoch slot; any number may be held at once, but nodes retired while the oldest
+    // is alive are not freed until it is released
+    snapshot read() const {
+        typename EpochDomain<>::Guard guard = domain_.pin();
+
+        return snapshot(this, std::move(guard), current_.load());
+    }
+
+    bool contains(const value_type& k) const { return read().contains(k); }
+
+    size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+    key_compare key_comp() const { return compare_; }
+
+    bool insert(const value_type& value) {
+        std::lock_guard<std::mutex> lock(writer_);
+        const state* old = current_.load();
+        ++version_;
+        bool inserted = false;
+        const node* root = insert_node(old->root, value, inserted);
+        if (inserted) {
+            publish(old, root, old->size + 1);
+        }
+
+        return inserted;
+    }
+
+    size_type erase(const value_type& value) {
+        std::lock_guard<std::mutex> lock(writer_);
+        const state* old = current_.load();
+        ++version_;
+        bool erased = false;
+        const node* root = erase_node(old->root, value, erased);
+        if (!erased) {
+            return 0;
+        }
+        publish(old, root, old->size - 1);
+
+        return 1;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(writer_);
+        const state* old = current_.load();
+        retire_tree(old->root);
+        publish(old, nullptr, 0);
+    }
+
+private:
+    static int height(const node* x) { return x == nullptr ? 0 : x->height; }
+
+    static void update(node* x) {
+        int left = height(x->left);
+        int right = height(x->right);
+        x->height = 1 + (left > right ? left : right);
+    }
+
+    static void reclaim_node(EpochRetired* p) { delete static_cast<node*>(p); }
+
+    static void reclaim_state(EpochRetired* p) { delete static_cast<state*>(p); }
+
+    // nodes stamped with the current version are private to this write and may be changed in place
+    node* own(const node* x) {
+        if (x->version == version_) {
+            return const_cast<node*>(x);
+        }
+        node* copy = new node(x->key, x->left, x->right, version_);
+        copy->height = x->height;
+        retired_.push_back(const_cast<node*>(x));
+
+        return copy;
+    }
+
+    node* rotate_left(node* x) {
+        node* y = own(x->right);
+        x->right = y->left;
+        y->left = x;
+        update(x);
+        update(y);
+
+        return y;
+    }
+
+    node* rotate_right(node* x) {
+        node* y = own(x->left);
+        x->left = y->right;
+        y->right = x;
+        update(x);
+        update(y);
+
+        return y;
+    }
+
+    node* rebalance(node* x) {
+        update(x);
+        int diff = height(x->left) - height(x->right);
+        if (diff > 1) {
+            if (height(x->left->left) < height(x->left->right)) {
+                x->left = rotate_left(own(x->left));
+            }
+
+            return rotate_right(x);
+        }
+        if (diff < -1) {
+            if (height(x->right->right) < height(x->right->left)) {
+                x->right = rotate_right(own(x->right));
+            }
+
+            return rotate_left(x);
+        }
+
+        return x;
+    }
+
+    const node* insert_node(const node* t, const value_type& value, bool& inserted) {
+        if (t == nullptr) {
+            inserted = true;
+
+            return new node(value, nullptr, nullptr, version_);
+        }
+        if (compare_(value, t->key)) {
+            const node* left = insert_node(t->left, value, inserted);
+            if (!inserted) {
+                return t;
+            }
+            node* x = own(t);
+            x->left = left;
+
+            return rebalance(x);
+        }
+        if (compare_(t->key, value)) {
+            const node* right = insert_node(t->right, value, inserted);
+            if (!inserted) {
+                return t;
+            }
+            node* x = own(t);
+            x->right = right;
+
+            return rebalance(x);
+        }
+
+        return t;
+    }
+
+    const node* erase_min(const node* t, const node*& minimum) {
+        if (t->left == nullptr) {
+            minimum = t;
+            retired_.push_back(const_cast<node*>(t));
+
+            return t->right;
+        }
+        const node* left = erase_min(t->left, minimum);
+        node* x = own(t);
+        x->left = left;
+
+        return rebalance(x);
+    }
+
+    const node* erase_node(const node* t, const value_type& value, bool& erased) {
+        if (t == nullptr) {
+            return nullptr;
+        }
+        if (compare_(value, t->key)) {
+            const node* left = erase_node(t->left, value, erased);
+            if (!erased) {
+                return t;
+            }
+            node* x = own(t);
+            x->left = left;
+
+            return rebalance(x);
+        }
+        if (compare_(t->key, value)) {
+            const node* right = erase_node(t->right, value, erased);
+            if (!erased) {
+                return t;
+            }
+            node* x = own(t);
+            x->right = right;
+
+            return rebalance(x);
+        }
+        erased = true;
+        if (t->left == nullptr || t->right == nullptr) {
+            retired_.push_back(const_cast<node*>(t));
+
+            return t->left != nullptr ? t->left : t->right;
+        }
+        const node* minimum;
+        const node* right = erase_min(t->right, minimum);
+        node* x = own(t);
+        x->key = minimum->key;
+        x->right = right;
+
+        return rebalance(x);
+    }
+
+    void retire_tree(const node* t) {
+        if (t != nullptr) {
+            retire_tree(t->left);
+            retire_tree(t->right);
+            retired_.push_back(const_cast<node*>(t));
+        }
+    }
+
+    void publish(const state* old, const node* root, size_type size) {
+        current_.store(new state(root, size));
+        size_.store(size, std::memory_order_relaxed);
+        state* previous = const_cast<state*>(old);
+        previous->reclaim = reclaim_state;
+        domain_.retire(previous);
+        for (node* x : retired_) {
+            x->reclaim = reclaim_node;
+            domain_.retire(x);
+        }
+        retired_.clear();
+    }
+
+    static void destroy(const node* t) {
+        if (t != nullptr) {
+            destroy(t->left);
+            destroy(t->right);
+            delete t;
+        }
+    }
+
+    mutable EpochDomain<> domain_;
+    [[no_unique_address]] Compare compare_;
+    std::atomic<const state*> current_;
+    std::atomic<size_type> size_;
+    std::mutex writer_;
+    std::vector<node*> retired_;
+    uint64_t version_;
+};
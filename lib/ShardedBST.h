@@ -0,0 +1,375 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+
+// shard i holds the keys in [split_points[i - 1], split_points[i]); each shard has its own lock and keeps its
+// own copy of those bounds, so the split points behind the layout lock only route a key to a first guess
+template<typename T, typename Balance = RedBlackPolicy, typename Compare = std::less<T> >
+class ShardedBST {
+public:
+    typedef T key_type;
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef Compare value_compare;
+    typedef const T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    // counted nodes keep split and finding the cut key O(log n) when rebalance() moves keys between shards
+    typedef BST<T, std::allocator<CountedNode<T> >, Balance, Compare> shard_type;
+
+private:
+    struct alignas(64) shard {
+        mutable std::shared_mutex mutex;
+        shard_type tree;
+        std::atomic<size_type> size{0};
+        // the keys this shard owns, [lower, upper), read and moved under its mutex; an empty bound is open
+        std::optional<T> lower;
+        std::optional<T> upper;
+    };
+
+    typedef typename shard_type::template const_iterator<TraverseTag::In> shard_iterator;
+
+public:
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef T value_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator() : tree_(nullptr), index_(0), current_(nullptr) {}
+
+        reference operator*() const { return *current_; }
+        pointer operator->() const { return &*current_; }
+
+        const_iterator& operator++() {
+            ++current_;
+            skip_empty();
+
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+
+            return temp;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return index_ == other.index_ && current_ == other.current_;
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class ShardedBST;
+
+        const_iterator(const ShardedBST* tree, size_type index)
+            : tree_(tree), index_(index), current_(nullptr) {
+            if (index_ < tree_->shards_.size()) {
+                current_ = tree_->shards_[index_].tree.template cbegin<TraverseTag::In>();
+                skip_empty();
+            }
+        }
+
+        void skip_empty() {
+            while (current_ == tree_->shards_[index_].tree.template cend<TraverseTag::In>()) {
+                if (++index_ == tree_->shards_.size()) {
+                    current_ = shard_iterator(nullptr);
+                    return;
+                }
+                current_ = tree_->shards_[index_].tree.template cbegin<TraverseTag::In>();
+            }
+        }
+
+        const ShardedBST* tree_;
+        size_type index_;
+        shard_iterator current_;
+    };
+
+    typedef const_iterator iterator;
+
+    // holds the layout lock and every shard lock in shared mode, so the walk sees one consistent state;
+    // writers, including ones on the same thread, block until the view is destroyed
+    class view {
+    public:
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator begin() const {
+            static_assert(tag == TraverseTag::In, "ShardedBST only iterates in order");
+
+            return const_iterator(tree_, 0);
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator end() const {
+            static_assert(tag == TraverseTag::In, "ShardedBST only iterates in order");
+
+            return const_iterator(tree_, tree_->shards_.size());
+        }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cbegin() const { return begin<tag>(); }
+
+        template<TraverseTag tag = TraverseTag::In>
+        const_iterator cend() const { return end<tag>(); }
+
+    private:
+        friend class ShardedBST;
+
+        explicit view(const ShardedBST* tree) : tree_(tree), layout_(tree->layout_) {
+            for (const shard& s : tree_->shards_) {
+                locks_.emplace_back(s.mutex);
+            }
+        }
+
+        const ShardedBST* tree_;
+        std::shared_lock<std::shared_mutex> layout_;
+        std::vector<std::shared_lock<std::shared_mutex> > locks_;
+    };
+
+    ShardedBST() : ShardedBST(std::vector<T>()) {}
+
+    explicit ShardedBST(std::vector<T> split_points, const Compare& compare = Compare())
+        : compare_(compare), splits_(std::move(split_points)), shards_(splits_.size() + 1) {
+        for (size_type i = 1; i < splits_.size(); ++i) {
+            if (compare_(splits_[i], splits_[i - 1])) {
+                std::cerr << "..error";
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        for (size_type i = 0; i < splits_.size(); ++i) {
+            shards_[i].upper = splits_[i];
+            shards_[i + 1].lower = splits_[i];
+        }
+    }
+
+    ShardedBST(std::vector<T> split_points, std::initializer_list<value_type> il) : ShardedBST(std::move(split_points)) {
+        for (const auto& value : il) {
+            insert(value);
+        }
+    }
+
+    ShardedBST(const ShardedBST&) = delete;
+    ShardedBST& operator=(const ShardedBST&) = delete;
+
+    // approximate while writers are running
+    size_type size() const {
+        size_type total = 0;
+        for (const shard& s : shards_) {
+            total += s.size.load(std::memory_order_relaxed);
+        }
+
+        return total;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    key_compare key_comp() const { return compare_; }
+
+    size_type shard_count() const { return shards_.size(); }
+
+    size_type shard_size(size_type i) const { return shards_[i].size.load(std::memory_order_relaxed); }
+
+    std::vector<T> split_points() const {
+        std::shared_lock<std::shared_mutex> layout(layout_);
+
+        return splits_;
+    }
+
+    view read() const { return view(this); }
+
+    bool contains(const value_type& key) const {
+        std::shared_lock<std::shared_mutex> lock;
+        const shard& s = shards_[lock_owner(key, lock)];
+
+        return s.tree.find(key) != s.tree.template cend<TraverseTag::In>();
+    }
+
+    bool insert(const value_type& key) {
+        std::unique_lock<std::shared_mutex> lock;
+        shard& s = shards_[lock_owner(key, lock)];
+        if (!s.tree.insert_check(key).second) {
+            return false;
+        }
+        s.size.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    size_type erase(const value_type& key) {
+        std::unique_lock<std::shared_mutex> lock;
+        shard& s = shards_[lock_owner(key, lock)];
+        size_type erased = s.tree.erase(key);
+        s.size.fetch_sub(erased, std::memory_order_relaxed);
+
+        return erased;
+    }
+
+    void clear() {
+        for (shard& s : shards_) {
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            s.tree.clear();
+            s.size.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // moves split points so every shard ends up with an equal share of the keys, once the largest shard
+    // holds more than max_skew times the average. each move locks only the two neighbouring shards it joins
+    // and splits, and the layout lock only while their split point is updated, so other writers keep going;
+    // a sweep to the right pushes surplus keys on and a sweep back to the left pulls missing keys in
+    bool rebalance(double max_skew = 2.0) {
+        std::lock_guard<std::mutex> rebalancing(rebalance_);
+        std::vector<size_type> sizes;
+        size_type total = 0;
+        size_type largest = 0;
+        for (const shard& s : shards_) {
+            sizes.push_back(s.size.load(std::memory_order_relaxed));
+            total += sizes.back();
+            largest = std::max(largest, sizes.back());
+        }
+        if (total == 0 || static_cast<double>(largest) * shards_.size() <= max_skew * total) {
+            return false;
+        }
+        size_type prefix = 0;
+        for (size_type i = 0; i + 1 < shards_.size(); ++i) {
+            size_type target = total * (i + 1) / shards_.size();
+            prefix += sizes[i];
+            if (prefix > target) {
+                size_type moved = give_back(i, prefix - target);
+                sizes[i] -= moved;
+                sizes[i + 1] += moved;
+                prefix -= moved;
+            }
+        }
+        size_type suffix = 0;
+        for (size_type i = shards_.size() - 1; i-- > 0;) {
+            size_type target = total * (i + 1) / shards_.size();
+            suffix += sizes[i + 1];
+            if (total - suffix < target) {
+                size_type moved = take_front(i, target - (total - suffix));
+                sizes[i] += moved;
+                sizes[i + 1] -= moved;
+                suffix -= moved;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    size_type route(const value_type& key) const {
+        return std::upper_bound(splits_.begin(), splits_.end(), key, compare_) - splits_.begin();
+    }
+
+    // splits_ may still trail a move rebalance() has made, so the guess is checked against the shard's own
+    // bounds under its lock, stepping to the neighbour the key moved to until the owner is found
+    template<typename Lock>
+    size_type lock_owner(const value_type& key, Lock& lock) const {
+        size_type i;
+        {
+            std::shared_lock<std::shared_mutex> layout(layout_);
+            i = route(key);
+        }
+        while (true) {
+            Lock candidate(shards_[i].mutex);
+            const shard& s = shards_[i];
+            if (s.lower && compare_(key, *s.lower)) {
+                --i;
+            } else if (s.upper && !compare_(key, *s.upper)) {
+                ++i;
+            } else {
+                lock = std::move(candidate);
+                return i;
+            }
+        }
+    }
+
+    // the last count keys of shard i move to the front of shard i + 1; returns how many moved
+    size_type give_back(size_type i, size_type count) {
+        shard& from = shards_[i];
+        shard& to = shards_[i + 1];
+        std::optional<T> key;
+        {
+            std::unique_lock<std::shared_mutex> first(from.mutex);
+            std::unique_lock<std::shared_mutex> second(to.mutex);
+            count = std::min(count, from.tree.size());
+            if (count == 0) {
+                return 0;
+            }
+            key = *from.tree.nth(from.tree.size() - count);
+            shard_type moved = from.tree.split(*key);
+            moved.join(to.tree);
+            to.tree.swap(moved);
+            move_bound(i, *key);
+        }
+        set_split(i, *key);
+
+        return count;
+    }
+
+    // the first count keys of shard i + 1 move to the back of shard i; returns how many moved. the last
+    // shard has no upper bound to hand over, so it always keeps one key
+    size_type take_front(size_type i, size_type count) {
+        shard& to = shards_[i];
+        shard& from = shards_[i + 1];
+        std::optional<T> key;
+        {
+            std::unique_lock<std::shared_mutex> first(to.mutex);
+            std::unique_lock<std::shared_mutex> second(from.mutex);
+            size_type available = from.upper ? from.tree.size() : std::max<size_type>(from.tree.size(), 1) - 1;
+            count = std::min(count, available);
+            if (count == 0) {
+                return 0;
+            }
+            if (count == from.tree.size()) {
+                key = from.upper;
+                to.tree.join(from.tree);
+            } else {
+                key = *from.tree.nth(count);
+                shard_type rest = from.tree.split(*key);
+                to.tree.join(from.tree);
+                from.tree.swap(rest);
+            }
+            move_bound(i, *key);
+        }
+        set_split(i, *key);
+
+        return count;
+    }
+
+    // called with both shards locked
+    void move_bound(size_type i, const T& key) {
+        shards_[i].upper = key;
+        shards_[i + 1].lower = key;
+        shards_[i].size.store(shards_[i].tree.size(), std::memory_order_relaxed);
+        shards_[i + 1].size.store(shards_[i + 1].tree.size(), std::memory_order_relaxed);
+    }
+
+    void set_split(size_type i, const T& key) {
+        std::unique_lock<std::shared_mutex> layout(layout_);
+        splits_[i] = key;
+    }
+
+    [[no_unique_address]] Compare compare_;
+    mutable std::shared_mutex layout_;
+    std::mutex rebalance_;
+    std::vector<T> splits_;
+    std::vector<shard> shards_;
+};
@@ -0,0 +1,194 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fork-join pool: every worker owns a deque it pushes to and pops from at the back, idle threads steal from
+// the front of the others; threads outside the pool share one extra deque
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads) : queues_(threads + 1), pending_(0), stop_(false) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // never destroyed, so trees copied or cleared while statics are torn down still find it running
+    static ThreadPool& instance() {
+        static ThreadPool* pool = new ThreadPool(std::max<size_t>(1, std::thread::hardware_concurrency()));
+
+        return *pool;
+    }
+
+    size_t size() const { return workers_.size(); }
+
+    // runs f on the calling thread while g waits to be stolen, and returns once both are done; if either throws,
+    // the exception is rethrown after both have finished, and g is skipped when f threw before anyone took it
+    template<typename F, typename G>
+    void invoke(F&& f, G&& g) {
+        job<G> forked(g);
+        queue& own = local_queue();
+        push(own, &forked);
+        std::exception_ptr error;
+        try {
+            f();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (pop_if(own, &forked)) {
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+            g();
+            return;
+        }
+        while (!forked.done.load(std::memory_order_acquire)) {
+            task* other = steal();
+            if (other != nullptr) {
+                other->run(other);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        if (error == nullptr) {
+            error = forked.error;
+        }
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    struct task {
+        void (*run)(task*) = nullptr;
+        std::atomic<bool> done{false};
+        std::exception_ptr error;
+    };
+
+    template<typename G>
+    struct job : task {
+        explicit job(G& g) : function(g) {
+            this->run = [](task* t) {
+                try {
+                    static_cast<job*>(t)->function();
+                } catch (...) {
+                    t->error = std::current_exception();
+                }
+                t->done.store(true, std::memory_order_release);
+            };
+        }
+
+        G& function;
+    };
+
+    struct alignas(64) queue {
+        std::mutex mutex;
+        std::deque<task*> tasks;
+    };
+
+    inline static thread_local const ThreadPool* current_pool_ = nullptr;
+    inline static thread_local size_t current_index_ = 0;
+
+    queue& local_queue() { return current_pool_ == this ? queues_[current_index_] : queues_.back(); }
+
+    void push(queue& q, task* t) {
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(t);
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        wake_.notify_one();
+    }
+
+    bool pop_if(queue& q, task* t) {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty() || q.tasks.back() != t) {
+            return false;
+        }
+        q.tasks.pop_back();
+        pending_.fetch_sub(1);
+
+        return true;
+    }
+
+    task* pop_back(queue& q) {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) {
+            return nullptr;
+        }
+        task* t = q.tasks.back();
+        q.tasks.pop_back();
+        pending_.fetch_sub(1);
+
+        return t;
+    }
+
+    task* steal() {
+        size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            queue& q = queues_[(start + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task* t = q.tasks.front();
+                q.tasks.pop_front();
+                pending_.fetch_sub(1);
+
+                return t;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void work(size_t index) {
+        current_pool_ = this;
+        current_index_ = index;
+        while (true) {
+            task* t = pop_back(queues_[index]);
+            if (t == nullptr) {
+                t = steal();
+            }
+            if (t != nullptr) {
+                t->run(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_.wait(lock, [this] { return stop_ || pending_.load() != 0; });
+            if (stop_ && pending_.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<queue> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> pending_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+};
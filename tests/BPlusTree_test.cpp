@@ -0,0 +1,100 @@
+#include "../lib/BPlusTree.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST(BPlusTreeTest, SimdSearchSelection) {
+    static_assert(!BPlusTree<std::string>::simd_search);
+    static_assert(!BPlusTree<int, std::greater<int> >::simd_search);
+#if defined(__SSE2__)
+    static_assert(BPlusTree<int>::simd_search);
+    static_assert(BPlusTree<double>::simd_search);
+#endif
+    BPlusTree<int> tree;
+    EXPECT_TRUE(tree.empty());
+    EXPECT_TRUE(tree.begin<TraverseTag::In>() == tree.end<TraverseTag::In>());
+    EXPECT_TRUE(tree.find(3) == tree.end<TraverseTag::In>());
+    EXPECT_EQ(tree.erase(3), 0);
+}
+
+TEST(BPlusTreeTest, MatchesBSTUnderChurn) {
+    std::mt19937 gen(3);
+    BPlusTree<int> tree;
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> reference;
+    for (int i = 0; i < 40000; ++i) {
+        int key = static_cast<int>(gen() % 10000) - 5000;
+        if (gen() % 3 != 0) {
+            EXPECT_EQ(tree.insert_check(key).second, reference.insert_check(key).second);
+        } else {
+            EXPECT_EQ(tree.erase(key), reference.erase(key));
+        }
+    }
+    EXPECT_EQ(tree.size(), reference.size());
+    std::vector<int> keys(tree.begin<TraverseTag::In>(), tree.end<TraverseTag::In>());
+    std::vector<int> expected(reference.cbegin<TraverseTag::In>(), reference.cend<TraverseTag::In>());
+    EXPECT_EQ(keys, expected);
+    std::vector<int> backward(tree.rbegin<TraverseTag::In>(), tree.rend<TraverseTag::In>());
+    std::reverse(expected.begin(), expected.end());
+    EXPECT_EQ(backward, expected);
+
+    for (int key = -5005; key < 5005; ++key) {
+        auto it = tree.find(key);
+        ASSERT_EQ(it == tree.end<TraverseTag::In>(), reference.find(key) == reference.end<TraverseTag::In>());
+        auto lower = tree.lower_bound(key);
+        auto reference_lower = reference.lower_bound(key);
+        ASSERT_EQ(lower == tree.end<TraverseTag::In>(), reference_lower == reference.end<TraverseTag::In>());
+        if (lower != tree.end<TraverseTag::In>()) {
+            EXPECT_EQ(*lower, *reference_lower);
+        }
+        auto upper = tree.upper_bound(key);
+        auto reference_upper = reference.upper_bound(key);
+        ASSERT_EQ(upper == tree.end<TraverseTag::In>(), reference_upper == reference.end<TraverseTag::In>());
+        if (upper != tree.end<TraverseTag::In>()) {
+            EXPECT_EQ(*upper, *reference_upper);
+        }
+    }
+}
+
+TEST(BPlusTreeTest, EraseByIteratorAndCopy) {
+    BPlusTree<double> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(i * 0.5);
+    }
+    BPlusTree<double> copy(tree);
+    EXPECT_TRUE(copy == tree);
+    for (auto it = tree.begin<TraverseTag::In>(); it != tree.end<TraverseTag::In>();) {
+        it = tree.erase(it);
+        if (it != tree.end<TraverseTag::In>()) {
+            ++it;
+        }
+    }
+    EXPECT_EQ(tree.size(), 500);
+    EXPECT_EQ(*tree.begin<TraverseTag::In>(), 0.5);
+    EXPECT_EQ(*tree.rbegin<TraverseTag::In>(), 499.5);
+    for (auto it = tree.begin<TraverseTag::In>(); it != tree.end<TraverseTag::In>();) {
+        it = tree.erase(it);
+    }
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(copy.size(), 1000);
+    EXPECT_TRUE(copy.contains(250.0));
+
+    tree = std::move(copy);
+    EXPECT_EQ(tree.size(), 1000);
+    EXPECT_TRUE(copy.empty());
+}
+
+TEST(BPlusTreeTest, ScalarFallbackForOtherKeys) {
+    BPlusTree<std::string> tree = {"delta", "alpha", "charlie", "bravo"};
+    for (int i = 0; i < 200; ++i) {
+        tree.insert("key" + std::to_string(i));
+    }
+    EXPECT_EQ(tree.size(), 204);
+    EXPECT_EQ(*tree.begin<TraverseTag::In>(), "alpha");
+    EXPECT_EQ(*tree.upper_bound("alpha"), "bravo");
+    EXPECT_EQ(tree.erase("charlie"), 1);
+    EXPECT_FALSE(tree.contains("charlie"));
+    EXPECT_TRUE(std::is_sorted(tree.begin<TraverseTag::In>(), tree.end<TraverseTag::In>()));
+}
@@ -1,6 +1,16 @@
 #include "../lib/BST.h"
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
 class BSTTest : public ::testing::Test {
 protected:
     BST<int> bst;
@@ -220,7 +230,7 @@ TEST_F(BSTTest, extract) {
     EXPECT_EQ(bst.size(), 2);
 
     auto extracted = bst.extract(2);
-    EXPECT_EQ(extracted.key, 2);
+    EXPECT_EQ(extracted.value(), 2);
     
     EXPECT_EQ(bst.size(), 1);
     EXPECT_TRUE(bst.find(2) == bst.end<TraverseTag::In>());
@@ -614,3 +624,1122 @@ TEST_F(BSTTest, ReversedPostorder) {
     }
     EXPECT_EQ(expected.str(), c_output.str());
 }
+
+template<typename N>
+int RedBlackHeight(const N* node) {
+    if (node == nullptr) {
+        return 1;
+    }
+    if (node->balance == RedBlackPolicy::red) {
+        EXPECT_TRUE(node->left == nullptr || node->left->balance == RedBlackPolicy::black);
+        EXPECT_TRUE(node->right == nullptr || node->right->balance == RedBlackPolicy::black);
+    }
+    int left = RedBlackHeight(node->left);
+    int right = RedBlackHeight(node->right);
+    EXPECT_EQ(left, right);
+
+    return left + (node->balance == RedBlackPolicy::black ? 1 : 0);
+}
+
+template<typename N>
+int AVLHeight(const N* node) {
+    if (node == nullptr) {
+        return 0;
+    }
+    int left = AVLHeight(node->left);
+    int right = AVLHeight(node->right);
+    EXPECT_LE(std::abs(left - right), 1);
+    EXPECT_EQ(node->balance, 1 + std::max(left, right));
+
+    return 1 + std::max(left, right);
+}
+
+template<typename Tree>
+int Height(Tree& tree) {
+    typedef std::remove_pointer_t<typename Tree::pointer> node;
+    std::vector<std::pair<const node*, int> > stack;
+    int height = 0;
+    if (!tree.empty()) {
+        stack.push_back({tree.template begin<TraverseTag::Pre>().operator->(), 1});
+    }
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        height = std::max(height, depth);
+        if (node->left != nullptr) {
+            stack.push_back({node->left, depth + 1});
+        }
+        if (node->right != nullptr) {
+            stack.push_back({node->right, depth + 1});
+        }
+    }
+
+    return height;
+}
+
+TEST(BSTBalanceTest, RedBlackSortedInsert) {
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree;
+    for (int i = 0; i < 1024; ++i) {
+        tree.insert(i);
+    }
+    EXPECT_EQ(tree.size(), 1024);
+    EXPECT_LE(Height(tree), 20);
+    auto root = tree.begin<TraverseTag::Pre>();
+    EXPECT_EQ(root->balance, RedBlackPolicy::black);
+    RedBlackHeight(root.operator->());
+
+    int expected = 0;
+    for (auto it = tree.begin<TraverseTag::In>(); it != tree.end<TraverseTag::In>(); ++it) {
+        EXPECT_EQ(*it, expected++);
+    }
+}
+
+TEST(BSTBalanceTest, AVLSortedInsert) {
+    BST<int, std::allocator<Node<int> >, AVLPolicy> tree;
+    for (int i = 1024; i > 0; --i) {
+        tree.insert(i);
+    }
+    EXPECT_EQ(tree.size(), 1024);
+    EXPECT_EQ(Height(tree), 11);
+    AVLHeight(tree.begin<TraverseTag::Pre>().operator->());
+}
+
+template<typename Policy>
+void RandomChurn(int (*check)(const Node<int>*)) {
+    BST<int, std::allocator<Node<int> >, Policy> tree;
+    std::vector<int> keys(2000);
+    for (int i = 0; i < 2000; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937 gen(42);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    for (int key : keys) {
+        tree.insert(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+    for (int i = 0; i < 1500; ++i) {
+        EXPECT_EQ(tree.erase(keys[i]), 1);
+        if (i % 100 == 0) {
+            check(tree.template begin<TraverseTag::Pre>().operator->());
+        }
+    }
+    EXPECT_EQ(tree.size(), 500);
+    check(tree.template begin<TraverseTag::Pre>().operator->());
+
+    std::vector<int> rest(keys.begin() + 1500, keys.end());
+    std::sort(rest.begin(), rest.end());
+    std::vector<int> output;
+    for (auto it = tree.template begin<TraverseTag::In>(); it != tree.template end<TraverseTag::In>(); ++it) {
+        output.push_back(*it);
+    }
+    EXPECT_EQ(output, rest);
+}
+
+TEST(BSTBalanceTest, RedBlackRandomErase) {
+    RandomChurn<RedBlackPolicy>(RedBlackHeight<Node<int> >);
+}
+
+TEST(BSTBalanceTest, AVLRandomErase) {
+    RandomChurn<AVLPolicy>(AVLHeight<Node<int> >);
+}
+
+TEST(BSTDepthTest, DegenerateChain) {
+    BST<int> chain;
+    for (int i = 0; i < 20000; ++i) {
+        chain.insert(i);
+    }
+    EXPECT_EQ(Height(chain), 20000);
+
+    BST<int> copy(chain);
+    EXPECT_EQ(copy.size(), 20000);
+    EXPECT_TRUE(copy == chain);
+    EXPECT_EQ(*copy.find(19999), 19999);
+
+    chain.clear();
+    EXPECT_TRUE(chain.empty());
+    EXPECT_EQ(copy.erase(0), 1);
+    EXPECT_EQ(copy.size(), 19999);
+}
+
+TEST(BSTDepthTest, InsertReturnsCreatedNode) {
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree = {5, 3, 8};
+    auto [it, inserted] = tree.insert_check(4);
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(*it, 4);
+    EXPECT_EQ(it, tree.find(4));
+    ++it;
+    EXPECT_EQ(*it, 5);
+}
+
+TEST(BSTHeaderTest, BoundsFollowEraseAndInsert) {
+    BST<int, std::allocator<Node<int> >, AVLPolicy> tree = {8, 4, 12, 2, 6, 10, 14};
+    EXPECT_EQ(*tree.begin<TraverseTag::In>(), 2);
+    EXPECT_EQ(*tree.rbegin<TraverseTag::In>(), 14);
+
+    tree.erase(2);
+    tree.erase(14);
+    EXPECT_EQ(*tree.begin<TraverseTag::In>(), 4);
+    EXPECT_EQ(*tree.rbegin<TraverseTag::In>(), 12);
+
+    tree.insert(1);
+    tree.insert(20);
+    EXPECT_EQ(*tree.cbegin<TraverseTag::In>(), 1);
+    EXPECT_EQ(*tree.crbegin<TraverseTag::In>(), 20);
+    EXPECT_EQ(tree.size(), 7);
+}
+
+TEST(BSTHeaderTest, EmptyTreeBounds) {
+    BST<int> tree;
+    EXPECT_EQ(tree.begin<TraverseTag::In>(), tree.end<TraverseTag::In>());
+    EXPECT_EQ(tree.begin<TraverseTag::Pre>(), tree.end<TraverseTag::Pre>());
+    EXPECT_EQ(tree.begin<TraverseTag::Post>(), tree.end<TraverseTag::Post>());
+    EXPECT_EQ(tree.rbegin<TraverseTag::Pre>(), tree.rend<TraverseTag::Pre>());
+    EXPECT_EQ(tree.crbegin<TraverseTag::Post>(), tree.crend<TraverseTag::Post>());
+
+    tree = {3};
+    tree.erase(3);
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.begin<TraverseTag::In>(), tree.end<TraverseTag::In>());
+}
+
+TEST(BSTHeaderTest, PostorderAfterRebalance) {
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree = {1, 2, 3};
+    EXPECT_EQ(*tree.begin<TraverseTag::Post>(), 1);
+    tree.insert(0);
+    EXPECT_EQ(*tree.begin<TraverseTag::Post>(), 0);
+    tree.insert(4);
+    tree.insert(5);
+    std::vector<int> output;
+    for (auto it = tree.begin<TraverseTag::Post>(); it != tree.end<TraverseTag::Post>(); ++it) {
+        output.push_back(*it);
+    }
+    EXPECT_EQ(output.size(), 6);
+    EXPECT_EQ(output.back(), 2);
+}
+
+TEST(BSTHeaderTest, SwapKeepsBounds) {
+    BST<int> first = {5, 1, 9};
+    BST<int> second = {7};
+    first.swap(second);
+    EXPECT_EQ(*first.begin<TraverseTag::In>(), 7);
+    EXPECT_EQ(*second.begin<TraverseTag::In>(), 1);
+    EXPECT_EQ(*second.rbegin<TraverseTag::In>(), 9);
+    EXPECT_EQ(second.size(), 3);
+}
+
+TEST(BSTNodePoolTest, ChurnReusesFreedNodes) {
+    BST<int, BSTNodePool<Node<int> >, RedBlackPolicy> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(i);
+    }
+    size_t chunks = tree.get_allocator().chunk_count();
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 1000; i += 2) {
+            tree.erase(i);
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            tree.insert(i);
+        }
+    }
+    EXPECT_EQ(tree.size(), 1000);
+    EXPECT_EQ(tree.get_allocator().chunk_count(), chunks);
+    RedBlackHeight(tree.begin<TraverseTag::Pre>().operator->());
+}
+
+TEST(BSTNodePoolTest, ClearReleasesChunks) {
+    BST<int, BSTNodePool<Node<int> > > tree = {5, 3, 8, 1, 4};
+    EXPECT_GT(tree.get_allocator().chunk_count(), 0);
+
+    BST<int, BSTNodePool<Node<int> > > copy(tree);
+    EXPECT_TRUE(copy.get_allocator() != tree.get_allocator());
+
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.get_allocator().chunk_count(), 0);
+    EXPECT_EQ(copy.size(), 5);
+    EXPECT_TRUE(copy.find(4) != copy.end<TraverseTag::In>());
+
+    tree.insert(7);
+    EXPECT_EQ(*tree.begin<TraverseTag::In>(), 7);
+}
+
+TEST(BSTNodePoolTest, SharedPoolFallsBackToPerNodeClear) {
+    BSTNodePool<Node<int> > pool;
+    BST<int, BSTNodePool<Node<int> > > first({1, 2, 3}, pool);
+    BST<int, BSTNodePool<Node<int> > > second({4, 5, 6}, pool);
+    first.clear();
+    EXPECT_EQ(pool.chunk_count(), 1);
+    EXPECT_EQ(second.size(), 3);
+    EXPECT_EQ(*second.begin<TraverseTag::In>(), 4);
+}
+
+struct CountingKey {
+    static int copies;
+
+    int value;
+    std::string payload;
+
+    CountingKey(int v, std::string p = "payload") : value(v), payload(std::move(p)) {}
+    CountingKey(const CountingKey& other) : value(other.value), payload(other.payload) { ++copies; }
+    CountingKey(CountingKey&& other) noexcept = default;
+    CountingKey& operator=(const CountingKey& other) {
+        value = other.value;
+        payload = other.payload;
+        ++copies;
+
+        return *this;
+    }
+    CountingKey& operator=(CountingKey&& other) noexcept = default;
+
+    bool operator==(const CountingKey& other) const { return value == other.value; }
+    bool operator<(const CountingKey& other) const { return value < other.value; }
+    bool operator>(const CountingKey& other) const { return value > other.value; }
+};
+
+int CountingKey::copies = 0;
+
+TEST(BSTMoveTest, InsertAndEmplaceDoNotCopy) {
+    BST<CountingKey, std::allocator<Node<CountingKey> >, RedBlackPolicy> tree;
+    CountingKey::copies = 0;
+    for (int i = 0; i < 100; ++i) {
+        tree.insert(CountingKey(i));
+    }
+    auto [it, inserted] = tree.emplace(200, "emplaced");
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(it->key.payload, "emplaced");
+    EXPECT_FALSE(tree.emplace(50).second);
+    EXPECT_EQ(tree.find(CountingKey(7))->key.value, 7);
+    EXPECT_EQ(CountingKey::copies, 0);
+    EXPECT_EQ(tree.size(), 101);
+}
+
+TEST(BSTMoveTest, MoveConstructAndAssign) {
+    BST<std::string> source = {"delta", "alpha", "charlie", "bravo"};
+    BST<std::string> moved(std::move(source));
+    EXPECT_TRUE(source.empty());
+    EXPECT_EQ(moved.size(), 4);
+    EXPECT_EQ(*moved.begin<TraverseTag::In>(), "alpha");
+    EXPECT_EQ(*moved.rbegin<TraverseTag::In>(), "delta");
+
+    BST<std::string> target = {"zulu"};
+    target = std::move(moved);
+    EXPECT_TRUE(moved.empty());
+    EXPECT_EQ(target.size(), 4);
+    EXPECT_TRUE(target.find("zulu") == target.end<TraverseTag::In>());
+
+    moved.insert("echo");
+    EXPECT_EQ(moved.size(), 1);
+}
+
+TEST(BSTMoveTest, MoveTreeDoesNotCopyKeys) {
+    BST<CountingKey> tree;
+    tree.emplace(1);
+    tree.emplace(2);
+    CountingKey::copies = 0;
+    BST<CountingKey> moved = std::move(tree);
+    BST<CountingKey> assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(CountingKey::copies, 0);
+    EXPECT_EQ(assigned.size(), 2);
+}
+
+TEST(BSTMoveTest, EmplaceHint) {
+    BST<int, std::allocator<Node<int> >, AVLPolicy> tree;
+    auto hint = tree.end<TraverseTag::In>();
+    for (int i = 0; i < 500; ++i) {
+        hint = tree.emplace_hint(hint, i);
+        ++hint;
+    }
+    EXPECT_EQ(tree.size(), 500);
+    AVLHeight(tree.begin<TraverseTag::Pre>().operator->());
+
+    auto it = tree.emplace_hint(tree.find(100), 100);
+    EXPECT_EQ(it, tree.find(100));
+    EXPECT_EQ(tree.size(), 500);
+
+    tree.erase(250);
+    it = tree.emplace_hint(tree.find(10), 250);
+    EXPECT_EQ(*it, 250);
+    EXPECT_EQ(tree.size(), 500);
+
+    int expected = 0;
+    for (auto cur = tree.begin<TraverseTag::In>(); cur != tree.end<TraverseTag::In>(); ++cur) {
+        EXPECT_EQ(*cur, expected++);
+    }
+}
+
+struct CountingLess {
+    int* calls;
+
+    bool operator()(int lhs, int rhs) const {
+        ++*calls;
+
+        return lhs < rhs;
+    }
+};
+
+TEST(BSTCompareTest, OneComparisonPerLevel) {
+    int calls = 0;
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy, CountingLess> tree(CountingLess{&calls});
+    for (int i = 0; i < 1024; ++i) {
+        tree.insert(i);
+    }
+    int height = Height(tree);
+
+    calls = 0;
+    EXPECT_TRUE(tree.find(517) != tree.end<TraverseTag::In>());
+    EXPECT_LE(calls, height + 1);
+
+    calls = 0;
+    tree.insert(517);
+    EXPECT_LE(calls, height + 1);
+    EXPECT_EQ(tree.size(), 1024);
+}
+
+TEST(BSTCompareTest, GreaterOrdersDescending) {
+    BST<int, std::allocator<Node<int> >, NoBalancePolicy, std::greater<int> > tree = {3, 1, 4, 5, 9, 2, 6};
+    std::vector<int> output;
+    for (auto it = tree.begin<TraverseTag::In>(); it != tree.end<TraverseTag::In>(); ++it) {
+        output.push_back(*it);
+    }
+    EXPECT_EQ(output, (std::vector<int>{9, 6, 5, 4, 3, 2, 1}));
+    EXPECT_EQ(tree.erase(4), 1);
+    EXPECT_TRUE(tree.find(4) == tree.end<TraverseTag::In>());
+    EXPECT_EQ(*tree.upper_bound(6), 5);
+}
+
+TEST(BSTCompareTest, TransparentLookup) {
+    BST<std::string, std::allocator<Node<std::string> >, AVLPolicy, std::less<> > tree = {"beta", "alpha", "gamma", "delta"};
+    std::string_view key = "delta";
+    auto it = tree.find(key);
+    ASSERT_TRUE(it != tree.end<TraverseTag::In>());
+    EXPECT_EQ(*it, "delta");
+    EXPECT_TRUE(tree.find(std::string_view("omega")) == tree.end<TraverseTag::In>());
+    EXPECT_EQ(*tree.lower_bound(std::string_view("beta")), "alpha");
+    EXPECT_EQ(*tree.upper_bound(std::string_view("beta")), "delta");
+
+    const auto& constant = tree;
+    EXPECT_EQ(*constant.find(std::string_view("gamma")), "gamma");
+}
+
+TEST(BSTBulkLoadTest, SortedConstructorIsBalanced) {
+    std::vector<int> keys(100000);
+    for (int i = 0; i < 100000; ++i) {
+        keys[i] = 2 * i;
+    }
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree(sorted_unique, keys.begin(), keys.end());
+    EXPECT_EQ(tree.size(), keys.size());
+    EXPECT_EQ(Height(tree), 17);
+    RedBlackHeight(tree.begin<TraverseTag::Pre>().operator->());
+    EXPECT_EQ(*tree.begin<TraverseTag::In>(), 0);
+    EXPECT_EQ(*tree.rbegin<TraverseTag::In>(), 199998);
+
+    std::vector<int> output(tree.begin<TraverseTag::In>(), tree.end<TraverseTag::In>());
+    EXPECT_EQ(output, keys);
+
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(2 * i + 1);
+        tree.erase(4 * i);
+    }
+    RedBlackHeight(tree.begin<TraverseTag::Pre>().operator->());
+}
+
+TEST(BSTBulkLoadTest, AssignSortedAllTraversals) {
+    BST<int, std::allocator<Node<int> >, AVLPolicy> tree = {100, 200};
+    tree.assign_sorted(1, 8);
+    EXPECT_EQ(tree.size(), 7);
+    AVLHeight(tree.begin<TraverseTag::Pre>().operator->());
+
+    std::stringstream pre;
+    for (auto it = tree.begin<TraverseTag::Pre>(); it != tree.end<TraverseTag::Pre>(); ++it) {
+        pre << *it << " ";
+    }
+    EXPECT_EQ(pre.str(), "4 2 1 3 6 5 7 ");
+
+    std::stringstream post;
+    for (auto it = tree.begin<TraverseTag::Post>(); it != tree.end<TraverseTag::Post>(); ++it) {
+        post << *it << " ";
+    }
+    EXPECT_EQ(post.str(), "1 3 2 5 7 6 4 ");
+
+    std::stringstream reversed;
+    for (auto it = tree.rbegin<TraverseTag::In>(); it != tree.rend<TraverseTag::In>(); ++it) {
+        reversed << *it << " ";
+    }
+    EXPECT_EQ(reversed.str(), "7 6 5 4 3 2 1 ");
+}
+
+TEST(BSTBulkLoadTest, EmptyAndUnbalancedPolicy) {
+    std::vector<std::string> empty;
+    BST<std::string> none(sorted_unique, empty.begin(), empty.end());
+    EXPECT_TRUE(none.empty());
+
+    std::vector<std::string> words = {"a", "b", "c", "d", "e", "f"};
+    BST<std::string> tree(sorted_unique, words.begin(), words.end());
+    EXPECT_EQ(Height(tree), 3);
+    EXPECT_EQ(*tree.begin<TraverseTag::Pre>(), "d");
+    tree.insert("g");
+    EXPECT_EQ(*tree.rbegin<TraverseTag::In>(), "g");
+}
+
+template<typename Tree>
+std::vector<int> InorderKeys(const Tree& tree) {
+    return std::vector<int>(tree.template cbegin<TraverseTag::In>(), tree.template cend<TraverseTag::In>());
+}
+
+TEST(BSTSetAlgebraTest, InPlaceUnionReusesNodes) {
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> lhs = {1, 3, 5, 7, 9};
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> rhs = {2, 3, 4, 9, 10};
+    const Node<int>* five = lhs.find(5).operator->();
+    const Node<int>* ten = rhs.find(10).operator->();
+
+    lhs.set_union(rhs);
+    EXPECT_TRUE(rhs.empty());
+    EXPECT_EQ(InorderKeys(lhs), (std::vector<int>{1, 2, 3, 4, 5, 7, 9, 10}));
+    EXPECT_EQ(lhs.size(), 8);
+    EXPECT_EQ(lhs.find(5).operator->(), five);
+    EXPECT_EQ(lhs.find(10).operator->(), ten);
+    RedBlackHeight(lhs.begin<TraverseTag::Pre>().operator->());
+}
+
+TEST(BSTSetAlgebraTest, InPlaceIntersectionAndDifference) {
+    BST<int, std::allocator<Node<int> >, AVLPolicy> tree(0, 20);
+    BST<int, std::allocator<Node<int> >, AVLPolicy> evens;
+    for (int i = 0; i < 40; i += 2) {
+        evens.insert(i);
+    }
+    BST<int, std::allocator<Node<int> >, AVLPolicy> odds(tree);
+
+    tree.set_intersection(evens);
+    EXPECT_EQ(InorderKeys(tree), (std::vector<int>{0, 2, 4, 6, 8, 10, 12, 14, 16, 18}));
+    AVLHeight(tree.begin<TraverseTag::Pre>().operator->());
+
+    odds.set_difference(evens);
+    EXPECT_EQ(odds.size(), 10);
+    EXPECT_EQ(*odds.begin<TraverseTag::In>(), 1);
+    EXPECT_EQ(*odds.rbegin<TraverseTag::In>(), 19);
+    AVLHeight(odds.begin<TraverseTag::Pre>().operator->());
+
+    odds.set_intersection(odds);
+    EXPECT_EQ(odds.size(), 10);
+    odds.set_difference(odds);
+    EXPECT_TRUE(odds.empty());
+}
+
+TEST(BSTSetAlgebraTest, FreeFunctionsLeaveOperandsIntact) {
+    BST<int> lhs = {5, 1, 9, 3};
+    BST<int> rhs = {3, 4, 5, 6};
+    EXPECT_EQ(InorderKeys(set_union(lhs, rhs)), (std::vector<int>{1, 3, 4, 5, 6, 9}));
+    EXPECT_EQ(InorderKeys(set_intersection(lhs, rhs)), (std::vector<int>{3, 5}));
+    EXPECT_EQ(InorderKeys(set_difference(lhs, rhs)), (std::vector<int>{1, 9}));
+    EXPECT_EQ(InorderKeys(set_difference(rhs, lhs)), (std::vector<int>{4, 6}));
+    EXPECT_EQ(lhs.size(), 4);
+    EXPECT_EQ(rhs.size(), 4);
+
+    BST<int> empty;
+    EXPECT_TRUE(set_intersection(lhs, empty).empty());
+    EXPECT_EQ(set_union(empty, rhs).size(), 4);
+}
+
+TEST(BSTSetAlgebraTest, UnionAcrossPools) {
+    BST<int, BSTNodePool<Node<int> > > lhs = {1, 2, 3};
+    BST<int, BSTNodePool<Node<int> > > rhs = {3, 4};
+    lhs.set_union(rhs);
+    EXPECT_TRUE(rhs.empty());
+    EXPECT_EQ(InorderKeys(lhs), (std::vector<int>{1, 2, 3, 4}));
+}
+
+TEST(BSTNodeHandleTest, TransferWithoutReallocation) {
+    BST<CountingKey, std::allocator<Node<CountingKey> >, RedBlackPolicy> hot;
+    BST<CountingKey, std::allocator<Node<CountingKey> >, RedBlackPolicy> cold;
+    for (int i = 0; i < 10; ++i) {
+        hot.emplace(i);
+    }
+    const Node<CountingKey>* address = hot.find(CountingKey(4)).operator->();
+    CountingKey::copies = 0;
+
+    auto handle = hot.extract(CountingKey(4));
+    ASSERT_FALSE(handle.empty());
+    EXPECT_EQ(handle.value().value, 4);
+    EXPECT_EQ(hot.size(), 9);
+    EXPECT_TRUE(hot.find(CountingKey(4)) == hot.end<TraverseTag::In>());
+
+    auto result = cold.insert(std::move(handle));
+    EXPECT_TRUE(result.inserted);
+    EXPECT_TRUE(handle.empty());
+    EXPECT_TRUE(result.node.empty());
+    EXPECT_EQ(result.position.operator->(), address);
+    EXPECT_EQ(cold.size(), 1);
+    EXPECT_EQ(CountingKey::copies, 0);
+}
+
+TEST(BSTNodeHandleTest, ExtractByIteratorAndDuplicate) {
+    BST<int> first = {5, 3, 8};
+    BST<int> second = {3};
+    auto handle = first.extract(first.begin<TraverseTag::In>());
+    EXPECT_EQ(handle.value(), 3);
+    EXPECT_EQ(*first.begin<TraverseTag::In>(), 5);
+
+    auto result = second.insert(std::move(handle));
+    EXPECT_FALSE(result.inserted);
+    EXPECT_EQ(*result.position, 3);
+    ASSERT_FALSE(result.node.empty());
+    EXPECT_EQ(result.node.value(), 3);
+
+    result.node.value() = 4;
+    auto retry = second.insert(std::move(result.node));
+    EXPECT_TRUE(retry.inserted);
+    EXPECT_EQ(second.size(), 2);
+
+    EXPECT_TRUE(first.extract(42).empty());
+    EXPECT_FALSE(first.insert(BST<int>::node_type()).inserted);
+}
+
+TEST(BSTNodeHandleTest, MergeSplicesNodes) {
+    BST<int> lhs = {10, 5};
+    BST<int> rhs = {7, 5, 12};
+    const Node<int>* seven = rhs.find(7).operator->();
+    lhs.merge(rhs);
+    EXPECT_TRUE(rhs.empty());
+    EXPECT_EQ(lhs.size(), 4);
+    EXPECT_EQ(lhs.find(7).operator->(), seven);
+}
+
+template<typename N>
+size_t CheckCounts(const N* node) {
+    if (node == nullptr) {
+        return 0;
+    }
+    size_t total = 1 + CheckCounts(node->left) + CheckCounts(node->right);
+    EXPECT_EQ(node->count, total);
+
+    return total;
+}
+
+TEST(BSTOrderStatisticTest, NthAndRank) {
+    BST<int, std::allocator<CountedNode<int> >, RedBlackPolicy> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(3 * i);
+    }
+    CheckCounts(tree.begin<TraverseTag::Pre>().operator->());
+    EXPECT_EQ(*tree.nth(0), 0);
+    EXPECT_EQ(*tree.nth(500), 1500);
+    EXPECT_EQ(*tree.nth(999), 2997);
+    EXPECT_TRUE(tree.nth(1000) == tree.end<TraverseTag::In>());
+
+    EXPECT_EQ(tree.rank(0), 0);
+    EXPECT_EQ(tree.rank(1500), 500);
+    EXPECT_EQ(tree.rank(1501), 501);
+    EXPECT_EQ(tree.rank(100000), 1000);
+    EXPECT_EQ(tree.count_range(3, 30), 9);
+    EXPECT_EQ(tree.count_range(30, 3), 0);
+}
+
+TEST(BSTOrderStatisticTest, CountsSurviveChurn) {
+    BST<int, std::allocator<CountedNode<int> >, AVLPolicy> tree(sorted_unique, 0, 512);
+    CheckCounts(tree.begin<TraverseTag::Pre>().operator->());
+    std::mt19937 gen(7);
+    for (int i = 0; i < 2000; ++i) {
+        int key = static_cast<int>(gen() % 1024);
+        if (gen() % 2 == 0) {
+            tree.insert(key);
+        } else {
+            tree.erase(key);
+        }
+    }
+    CheckCounts(tree.begin<TraverseTag::Pre>().operator->());
+    AVLHeight(tree.begin<TraverseTag::Pre>().operator->());
+
+    BST<int, std::allocator<CountedNode<int> >, AVLPolicy> copy(tree);
+    CheckCounts(copy.begin<TraverseTag::Pre>().operator->());
+    auto handle = copy.extract(copy.nth(3));
+    CheckCounts(copy.begin<TraverseTag::Pre>().operator->());
+    copy.insert(std::move(handle));
+    CheckCounts(copy.begin<TraverseTag::Pre>().operator->());
+
+    int k = 0;
+    for (auto it = tree.begin<TraverseTag::In>(); it != tree.end<TraverseTag::In>(); ++it, ++k) {
+        EXPECT_EQ(tree.rank(*it), k);
+    }
+}
+
+TEST(BSTOrderStatisticTest, RandomAccessInorderIterators) {
+    BST<int, std::allocator<CountedNode<int> >, RedBlackPolicy> tree(sorted_unique, 0, 100);
+    static_assert(std::is_same_v<std::iterator_traits<decltype(tree.begin<TraverseTag::In>())>::iterator_category,
+                                 std::random_access_iterator_tag>);
+    EXPECT_EQ(std::distance(tree.begin<TraverseTag::In>(), tree.end<TraverseTag::In>()), 100);
+    EXPECT_EQ(std::distance(tree.find(10), tree.find(42)), 32);
+    EXPECT_EQ(std::distance(tree.find(42), tree.find(10)), -32);
+
+    auto it = tree.begin<TraverseTag::In>();
+    std::advance(it, 57);
+    EXPECT_EQ(*it, 57);
+    EXPECT_EQ(*(it - 7), 50);
+    EXPECT_EQ(it[3], 60);
+    EXPECT_TRUE(tree.find(3) < it);
+    EXPECT_EQ(*std::lower_bound(tree.cbegin<TraverseTag::In>(), tree.cend<TraverseTag::In>(), 77), 77);
+
+    it += 43;
+    EXPECT_TRUE(it == tree.end<TraverseTag::In>());
+}
+
+TEST(BSTOrderStatisticTest, StepBackFromEnd) {
+    typedef BST<int, std::allocator<CountedNode<int> >, AVLPolicy> Tree;
+    static_assert(std::random_access_iterator<Tree::iterator<TraverseTag::In> >);
+    static_assert(std::bidirectional_iterator<Tree::const_iterator<TraverseTag::Post> >);
+    Tree tree(sorted_unique, 0, 100);
+    auto end = tree.end<TraverseTag::In>();
+    EXPECT_EQ(*(end - 1), 99);
+    EXPECT_EQ(*(end - 100), 0);
+    EXPECT_EQ(*std::prev(tree.cend<TraverseTag::In>(), 25), 75);
+    EXPECT_EQ(end - tree.begin<TraverseTag::In>(), 100);
+
+    auto it = tree.end<TraverseTag::In>();
+    std::ranges::advance(it, -10);
+    EXPECT_EQ(*it, 90);
+    it += 10;
+    EXPECT_TRUE(it == end);
+    it -= 100;
+    EXPECT_EQ(*it, 0);
+
+    auto missing = tree.find(500);
+    EXPECT_EQ(*(missing - 2), 98);
+    EXPECT_EQ(*--tree.end<TraverseTag::In>(), 99);
+
+    Tree empty;
+    EXPECT_EQ(empty.end<TraverseTag::In>() - empty.begin<TraverseTag::In>(), 0);
+}
+
+TEST(BSTRangeTest, EqualRange) {
+    BST<int> tree = {10, 5, 15, 3, 7};
+    auto [first, last] = tree.equal_range(7);
+    EXPECT_EQ(*first, 7);
+    EXPECT_EQ(*last, 10);
+
+    auto missing = tree.equal_range(8);
+    EXPECT_EQ(missing.first, missing.second);
+    EXPECT_EQ(*missing.first, 10);
+
+    const auto& constant = tree;
+    auto top = constant.equal_range(15);
+    EXPECT_EQ(*top.first, 15);
+    EXPECT_TRUE(top.second == constant.cend<TraverseTag::In>());
+}
+
+TEST(BSTRangeTest, ForEachInRange) {
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree(sorted_unique, 0, 1000);
+    std::vector<int> visited;
+    tree.for_each_in_range(100, 110, [&](const int& key) { visited.push_back(key); });
+    EXPECT_EQ(visited, (std::vector<int>{100, 101, 102, 103, 104, 105, 106, 107, 108, 109}));
+
+    visited.clear();
+    tree.for_each_in_range(995, 5000, [&](int key) { visited.push_back(key); });
+    EXPECT_EQ(visited, (std::vector<int>{995, 996, 997, 998, 999}));
+
+    visited.clear();
+    tree.for_each_in_range(50, 50, [&](int key) { visited.push_back(key); });
+    tree.for_each_in_range(2000, 3000, [&](int key) { visited.push_back(key); });
+    EXPECT_TRUE(visited.empty());
+}
+
+TEST(BSTRangeTest, RangeView) {
+    BST<std::string> tree = {"apple", "banana", "cherry", "date", "elderberry", "fig"};
+    std::vector<std::string> output;
+    for (const auto& key : tree.range("b", "e")) {
+        output.push_back(key);
+    }
+    EXPECT_EQ(output, (std::vector<std::string>{"banana", "cherry", "date"}));
+
+    EXPECT_TRUE(tree.range("x", "z").empty());
+    EXPECT_TRUE(tree.range("e", "b").empty());
+    auto all = tree.range("", "zzz");
+    EXPECT_EQ(*all.begin(), "apple");
+    EXPECT_TRUE(all.end() == tree.cend<TraverseTag::In>());
+}
+
+template<typename Tree>
+void SplitJoinRoundTrip(int (*check)(const std::remove_pointer_t<typename Tree::pointer>*)) {
+    std::vector<int> keys(1000);
+    for (int i = 0; i < 1000; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::mt19937 gen(11);
+    std::shuffle(keys.begin(), keys.end(), gen);
+    for (int pivot : {-1, 0, 1, 501, 1000, 1998, 1999, 5000}) {
+        Tree tree(keys.begin(), keys.end());
+        auto node = tree.find(1000).operator->();
+        Tree upper = tree.split(pivot);
+        size_t lower_size = pivot <= 0 ? 0 : std::min(1000, (pivot + 1) / 2);
+        EXPECT_EQ(tree.size(), lower_size);
+        EXPECT_EQ(upper.size(), 1000 - lower_size);
+        EXPECT_EQ(static_cast<size_t>(std::distance(tree.template begin<TraverseTag::In>(), tree.template end<TraverseTag::In>())), lower_size);
+        if (!tree.empty()) {
+            check(tree.template begin<TraverseTag::Pre>().operator->());
+            EXPECT_EQ(*tree.template rbegin<TraverseTag::In>(), 2 * static_cast<int>(lower_size) - 2);
+        }
+        if (!upper.empty()) {
+            check(upper.template begin<TraverseTag::Pre>().operator->());
+            EXPECT_EQ(*upper.template begin<TraverseTag::In>(), 2 * static_cast<int>(lower_size));
+        }
+        EXPECT_LE(Height(tree), 22);
+        EXPECT_LE(Height(upper), 22);
+
+        tree.join(upper);
+        EXPECT_TRUE(upper.empty());
+        EXPECT_EQ(tree.size(), 1000);
+        check(tree.template begin<TraverseTag::Pre>().operator->());
+        EXPECT_EQ(tree.find(1000).operator->(), node);
+        std::vector<int> sorted(keys);
+        std::sort(sorted.begin(), sorted.end());
+        EXPECT_EQ(InorderKeys(tree), sorted);
+    }
+}
+
+TEST(BSTSplitJoinTest, RedBlack) {
+    SplitJoinRoundTrip<BST<int, std::allocator<Node<int> >, RedBlackPolicy> >(RedBlackHeight<Node<int> >);
+}
+
+TEST(BSTSplitJoinTest, CountedAVL) {
+    typedef BST<int, std::allocator<CountedNode<int> >, AVLPolicy> Tree;
+    SplitJoinRoundTrip<Tree>(AVLHeight<CountedNode<int> >);
+
+    Tree tree(sorted_unique, 0, 300);
+    Tree upper = tree.split(100);
+    CheckCounts(tree.begin<TraverseTag::Pre>().operator->());
+    CheckCounts(upper.begin<TraverseTag::Pre>().operator->());
+    EXPECT_EQ(tree.rank(99), 99);
+    EXPECT_EQ(*upper.nth(0), 100);
+    Tree joined = join(std::move(tree), std::move(upper));
+    CheckCounts(joined.begin<TraverseTag::Pre>().operator->());
+    EXPECT_EQ(*joined.nth(150), 150);
+}
+
+TEST(BSTSplitJoinTest, UnbalancedAndEmpty) {
+    BST<int> tree = {10, 5, 15, 3, 7, 12, 20};
+    BST<int> upper = tree.split(10);
+    EXPECT_EQ(InorderKeys(tree), (std::vector<int>{3, 5, 7}));
+    EXPECT_EQ(InorderKeys(upper), (std::vector<int>{10, 12, 15, 20}));
+    EXPECT_EQ(*upper.rbegin<TraverseTag::In>(), 20);
+
+    BST<int> empty;
+    BST<int> rest = empty.split(4);
+    EXPECT_TRUE(rest.empty());
+    empty.join(tree);
+    EXPECT_EQ(InorderKeys(empty), (std::vector<int>{3, 5, 7}));
+    empty.join(rest);
+    empty.join(upper);
+    EXPECT_EQ(empty.size(), 7);
+    EXPECT_EQ(InorderKeys(empty), (std::vector<int>{3, 5, 7, 10, 12, 15, 20}));
+}
+
+TEST(BSTBatchLookupTest, MatchesFind) {
+    std::mt19937 gen(9);
+    BST<int, std::allocator<Node<int> >, AVLPolicy> tree;
+    for (int i = 0; i < 3000; ++i) {
+        tree.insert(static_cast<int>(gen() % 10000));
+    }
+    std::vector<int> keys(1001);
+    for (int& key : keys) {
+        key = static_cast<int>(gen() % 10000);
+    }
+    std::vector<BST<int, std::allocator<Node<int> >, AVLPolicy>::iterator<TraverseTag::In> > found(keys.size(), tree.end<TraverseTag::In>());
+    tree.find_batch(keys, found);
+    std::unique_ptr<bool[]> present(new bool[keys.size()]);
+    tree.contains_batch(keys, std::span<bool>(present.get(), keys.size()));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_TRUE(found[i] == tree.find(keys[i]));
+        EXPECT_EQ(present[i], tree.find(keys[i]) != tree.end<TraverseTag::In>());
+    }
+
+    const auto& constant = tree;
+    std::vector<BST<int, std::allocator<Node<int> >, AVLPolicy>::const_iterator<TraverseTag::In> > const_found(3, constant.cend<TraverseTag::In>());
+    int first = *constant.cbegin<TraverseTag::In>();
+    int last = *constant.crbegin<TraverseTag::In>();
+    constant.find_batch(std::vector<int>{first, -1, last}, const_found);
+    EXPECT_EQ(*const_found[0], first);
+    EXPECT_TRUE(const_found[1] == constant.cend<TraverseTag::In>());
+    EXPECT_EQ(*const_found[2], last);
+}
+
+TEST(BSTBatchLookupTest, EmptyTreeAndEmptyBatch) {
+    BST<std::string> tree;
+    std::vector<std::string> keys = {"a", "b"};
+    bool present[2] = {true, true};
+    tree.contains_batch(keys, present);
+    EXPECT_FALSE(present[0]);
+    EXPECT_FALSE(present[1]);
+    tree.insert("b");
+    tree.contains_batch(keys, present);
+    EXPECT_FALSE(present[0]);
+    EXPECT_TRUE(present[1]);
+    tree.contains_batch({}, {});
+}
+
+template<typename Tree>
+void ExpectSameStructure(const Tree& lhs, const Tree& rhs) {
+    std::vector<int> pre(lhs.template cbegin<TraverseTag::Pre>(), lhs.template cend<TraverseTag::Pre>());
+    std::vector<int> post(lhs.template cbegin<TraverseTag::Post>(), lhs.template cend<TraverseTag::Post>());
+    EXPECT_EQ(pre, std::vector<int>(rhs.template cbegin<TraverseTag::Pre>(), rhs.template cend<TraverseTag::Pre>()));
+    EXPECT_EQ(post, std::vector<int>(rhs.template cbegin<TraverseTag::Post>(), rhs.template cend<TraverseTag::Post>()));
+    std::vector<int> backward;
+    for (auto it = rhs.template crbegin<TraverseTag::In>(); it != rhs.template crend<TraverseTag::In>(); ++it) {
+        backward.push_back(*it);
+    }
+    std::vector<int> forward(lhs.template cbegin<TraverseTag::In>(), lhs.template cend<TraverseTag::In>());
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(forward, backward);
+}
+
+// constructed before the thread pool, so it is destroyed after it once the test binary exits
+BST<int, std::allocator<Node<int> >, RedBlackPolicy> static_tree;
+
+TEST(BSTParallelTest, StaticTreeOutlivesPoolUse) {
+    for (int i = 0; i < 100000; ++i) {
+        static_tree.insert(i);
+    }
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> copy(static_tree);
+    EXPECT_EQ(copy.size(), static_tree.size());
+}
+
+TEST(BSTParallelTest, CopyAndAssignAboveCutoff) {
+    std::mt19937 gen(23);
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree;
+    for (int i = 0; i < 100000; ++i) {
+        tree.insert(static_cast<int>(gen()));
+    }
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> copy(tree);
+    EXPECT_TRUE(copy == tree);
+    ExpectSameStructure(copy, tree);
+    copy.insert(-1);
+    copy.erase(*tree.cbegin<TraverseTag::In>());
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> assigned;
+    assigned.insert(5);
+    assigned = copy;
+    EXPECT_TRUE(assigned == copy);
+    ExpectSameStructure(assigned, copy);
+    copy.clear();
+    EXPECT_TRUE(copy.empty());
+    EXPECT_TRUE(copy.cbegin<TraverseTag::In>() == copy.cend<TraverseTag::In>());
+}
+
+TEST(BSTParallelTest, CountedCopyKeepsRanks) {
+    BST<int, std::allocator<CountedNode<int> >, AVLPolicy> tree;
+    for (int i = 0; i < 70000; ++i) {
+        tree.insert(i);
+    }
+    BST<int, std::allocator<CountedNode<int> >, AVLPolicy> copy(tree);
+    ExpectSameStructure(copy, tree);
+    for (int i = 0; i < 70000; i += 997) {
+        EXPECT_EQ(copy.cbegin<TraverseTag::In>()[i], i);
+    }
+}
+
+TEST(BSTParallelTest, ForEachVisitsEveryNode) {
+    BST<int, std::allocator<Node<int> >, AVLPolicy> tree;
+    for (int i = 0; i < 50000; ++i) {
+        tree.insert(i);
+    }
+    std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[50000]);
+    auto check = [&](auto visit) {
+        for (int i = 0; i < 50000; ++i) {
+            visits[i].store(0);
+        }
+        visit();
+        for (int i = 0; i < 50000; ++i) {
+            ASSERT_EQ(visits[i].load(), 1);
+        }
+    };
+    auto count = [&](int key) { visits[key].fetch_add(1); };
+    check([&] { tree.parallel_for_each(count); });
+    check([&] { tree.parallel_for_each<TraverseTag::Pre>(count); });
+    check([&] { tree.parallel_for_each<TraverseTag::Post>(count); });
+
+    BST<int, std::allocator<Node<int> >, AVLPolicy> small = {3, 1, 2};
+    std::vector<int> order;
+    small.parallel_for_each<TraverseTag::Post>([&](int key) { order.push_back(key); });
+    EXPECT_EQ(order, std::vector<int>(small.cbegin<TraverseTag::Post>(), small.cend<TraverseTag::Post>()));
+}
+
+TEST(BSTParallelTest, PoolAllocatorStaysSerial) {
+    BST<int, BSTNodePool<Node<int> >, RedBlackPolicy> tree;
+    for (int i = 0; i < 40000; ++i) {
+        tree.insert(i);
+    }
+    BST<int, BSTNodePool<Node<int> >, RedBlackPolicy> copy(tree);
+    EXPECT_TRUE(copy == tree);
+    copy.clear();
+    EXPECT_EQ(tree.size(), 40000);
+}
+
+struct ThrowingKey {
+    inline static std::atomic<long> live{0};
+    inline static std::atomic<long> copies_left{0};
+
+    int value;
+
+    explicit ThrowingKey(int v) : value(v) { ++live; }
+
+    ThrowingKey(const ThrowingKey& other) : value(other.value) {
+        if (copies_left.fetch_sub(1) <= 0) {
+            throw std::runtime_error("copy");
+        }
+        ++live;
+    }
+
+    ~ThrowingKey() { --live; }
+
+    bool operator<(const ThrowingKey& other) const { return value < other.value; }
+};
+
+TEST(BSTParallelTest, CopyWithThrowingKeyFreesPartialTree) {
+    typedef BST<ThrowingKey, std::allocator<Node<ThrowingKey> >, RedBlackPolicy> Tree;
+    {
+        ThrowingKey::copies_left = 1L << 30;
+        Tree tree;
+        for (int i = 0; i < 70000; ++i) {
+            tree.insert(ThrowingKey(i));
+        }
+        long live = ThrowingKey::live;
+        for (long allowed : {0L, 1L, 35000L, 69999L}) {
+            ThrowingKey::copies_left = allowed;
+            EXPECT_THROW(Tree copy(tree), std::runtime_error);
+            EXPECT_EQ(ThrowingKey::live, live);
+        }
+        ThrowingKey::copies_left = 1L << 30;
+        Tree copy(tree);
+        EXPECT_EQ(copy.size(), tree.size());
+    }
+    EXPECT_EQ(ThrowingKey::live, 0);
+}
+
+TEST(ThreadPoolTest, InvokeRethrowsAfterBothFinish) {
+    ThreadPool pool(2);
+    for (int i = 0; i < 100; ++i) {
+        std::atomic<bool> ran{false};
+        EXPECT_THROW(pool.invoke([] { throw std::runtime_error("f"); }, [&] { ran = true; }), std::runtime_error);
+        EXPECT_THROW(pool.invoke([&] { ran = true; }, [] { throw std::logic_error("g"); }), std::logic_error);
+        EXPECT_TRUE(ran);
+    }
+    std::atomic<int> sum{0};
+    pool.invoke([&] { sum += 1; }, [&] { sum += 2; });
+    EXPECT_EQ(sum, 3);
+}
+
+TEST(ThreadPoolTest, NestedInvoke) {
+    ThreadPool pool(3);
+    std::function<long(int)> sum = [&](int n) -> long {
+        if (n < 64) {
+            long total = 0;
+            for (int i = 0; i < n; ++i) {
+                total += i;
+            }
+
+            return total;
+        }
+        long left = 0;
+        long right = 0;
+        pool.invoke([&] { left = sum(n / 2); }, [&] { right = sum(n - n / 2); });
+
+        return left + right + static_cast<long>(n / 2) * (n - n / 2);
+    };
+    EXPECT_EQ(sum(100000), 100000L * 99999 / 2);
+}
+
+template<typename Tree>
+void CheckThreads(const Tree& tree) {
+    std::vector<int> forward = InorderKeys(tree);
+    std::vector<int> by_shape;
+    for (auto it = tree.template cbegin<TraverseTag::Pre>(); it != tree.template cend<TraverseTag::Pre>(); ++it) {
+        auto node = it.operator->();
+        EXPECT_TRUE(node->next == nullptr || node->next->prev == node);
+        EXPECT_TRUE(node->prev == nullptr || node->prev->next == node);
+        by_shape.push_back(node->key);
+    }
+    std::sort(by_shape.begin(), by_shape.end());
+    EXPECT_EQ(forward, by_shape);
+    std::vector<int> backward;
+    for (auto it = tree.template crbegin<TraverseTag::In>(); it != tree.template crend<TraverseTag::In>(); ++it) {
+        backward.push_back(*it);
+    }
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(forward, backward);
+}
+
+TEST(BSTThreadedTest, MatchesPlainTree) {
+    typedef BST<int, std::allocator<ThreadedNode<int> >, RedBlackPolicy> Tree;
+    std::mt19937 gen(21);
+    Tree tree;
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> plain;
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 3000);
+        switch (gen() % 4) {
+        case 0:
+            tree.insert(key);
+            plain.insert(key);
+            break;
+        case 1:
+            tree.emplace_hint(tree.find(key + 1), key);
+            plain.insert(key);
+            break;
+        case 2:
+            tree.erase(key);
+            plain.erase(key);
+            break;
+        default:
+            if (auto handle = tree.extract(key)) {
+                handle.value() = key + 3000;
+                tree.insert(std::move(handle));
+                plain.erase(key);
+                plain.insert(key + 3000);
+            }
+        }
+    }
+    EXPECT_EQ(InorderKeys(tree), InorderKeys(plain));
+    CheckThreads(tree);
+
+    Tree other = {-5, 1, 2, 7000};
+    tree.merge(other);
+    plain.insert({-5, 7000});
+    EXPECT_EQ(InorderKeys(tree), InorderKeys(plain));
+    CheckThreads(tree);
+    CheckThreads(other);
+}
+
+TEST(BSTThreadedTest, SplitJoinAndBulkBuilds) {
+    SplitJoinRoundTrip<BST<int, std::allocator<ThreadedNode<int> >, RedBlackPolicy> >(RedBlackHeight<ThreadedNode<int> >);
+
+    typedef BST<int, std::allocator<Node<int, SubtreeSize, InorderLinks> >, AVLPolicy> Tree;
+    Tree tree(sorted_unique, 0, 1000);
+    Tree upper = tree.split(400);
+    CheckThreads(tree);
+    CheckThreads(upper);
+    EXPECT_EQ(*(upper.begin<TraverseTag::In>() + 10), 410);
+    tree.join(upper);
+    CheckThreads(tree);
+
+    Tree odd;
+    for (int i = 1; i < 1000; i += 2) {
+        odd.insert(i);
+    }
+    tree.set_difference(odd);
+    CheckThreads(tree);
+    EXPECT_EQ(tree.size(), 500);
+    tree.set_union(odd);
+    CheckThreads(tree);
+    EXPECT_EQ(tree.size(), 1000);
+}
+
+TEST(BSTThreadedTest, CopyAboveParallelCutoff) {
+    typedef BST<int, std::allocator<ThreadedNode<int> >, AVLPolicy> Tree;
+    std::vector<int> keys(100000);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = static_cast<int>(i);
+    }
+    Tree tree(sorted_unique, keys.begin(), keys.end());
+    Tree copy(tree);
+    CheckThreads(copy);
+    Tree small = {3, 1, 2};
+    copy = small;
+    CheckThreads(copy);
+    EXPECT_EQ(InorderKeys(copy), (std::vector<int>{1, 2, 3}));
+}
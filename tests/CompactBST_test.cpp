@@ -0,0 +1,133 @@
+#include "../lib/CompactBST.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// rebuilds the unique BST with this pre-order and returns its height
+int PreorderHeight(const std::vector<int>& pre, size_t& pos, int lo, int hi) {
+    if (pos == pre.size() || pre[pos] < lo || pre[pos] > hi) {
+        return 0;
+    }
+    int key = pre[pos++];
+    int left = PreorderHeight(pre, pos, lo, key - 1);
+    int right = PreorderHeight(pre, pos, key + 1, hi);
+
+    return 1 + std::max(left, right);
+}
+
+template<TraverseTag tag>
+void ExpectReverseMatches(const CompactBST<int>& tree) {
+    std::vector<int> forward(tree.cbegin<tag>(), tree.cend<tag>());
+    std::vector<int> backward(tree.crbegin<tag>(), tree.crend<tag>());
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(forward, backward);
+    EXPECT_EQ(forward.size(), tree.size());
+}
+
+TEST(CompactBSTTest, MatchesBSTAndStaysBalanced) {
+    std::mt19937 gen(43);
+    CompactBST<int> tree;
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> reference;
+    for (int i = 0; i < 40000; ++i) {
+        int key = static_cast<int>(gen() % 5000);
+        if (gen() % 3 != 0) {
+            EXPECT_EQ(tree.insert_check(key).second, reference.insert_check(key).second);
+        } else {
+            EXPECT_EQ(tree.erase(key), reference.erase(key));
+        }
+    }
+    EXPECT_EQ(tree.size(), reference.size());
+    std::vector<int> keys(tree.cbegin<TraverseTag::In>(), tree.cend<TraverseTag::In>());
+    EXPECT_EQ(keys, std::vector<int>(reference.cbegin<TraverseTag::In>(), reference.cend<TraverseTag::In>()));
+    ExpectReverseMatches<TraverseTag::In>(tree);
+    ExpectReverseMatches<TraverseTag::Pre>(tree);
+    ExpectReverseMatches<TraverseTag::Post>(tree);
+
+    std::vector<int> pre(tree.cbegin<TraverseTag::Pre>(), tree.cend<TraverseTag::Pre>());
+    size_t pos = 0;
+    int height = PreorderHeight(pre, pos, -1, 5000);
+    EXPECT_EQ(pos, pre.size());
+    EXPECT_LE(height, 2 * std::bit_width(tree.size() + 1));
+
+    for (int key = -1; key < 5001; ++key) {
+        ASSERT_EQ(tree.contains(key), reference.find(key) != reference.end<TraverseTag::In>());
+        auto lower = tree.lower_bound(key);
+        auto reference_lower = reference.lower_bound(key);
+        ASSERT_EQ(lower == tree.end<TraverseTag::In>(), reference_lower == reference.end<TraverseTag::In>());
+        if (lower != tree.end<TraverseTag::In>()) {
+            EXPECT_EQ(*lower, *reference_lower);
+        }
+        auto upper = tree.upper_bound(key);
+        auto reference_upper = reference.upper_bound(key);
+        ASSERT_EQ(upper == tree.end<TraverseTag::In>(), reference_upper == reference.end<TraverseTag::In>());
+        if (upper != tree.end<TraverseTag::In>()) {
+            EXPECT_EQ(*upper, *reference_upper);
+        }
+    }
+}
+
+TEST(CompactBSTTest, TraversalOrders) {
+    CompactBST<int> tree = {1, 2, 3, 4, 5, 6, 7};
+    EXPECT_EQ(std::vector<int>(tree.cbegin<TraverseTag::Pre>(), tree.cend<TraverseTag::Pre>()),
+              std::vector<int>({2, 1, 4, 3, 6, 5, 7}));
+    EXPECT_EQ(std::vector<int>(tree.cbegin<TraverseTag::Post>(), tree.cend<TraverseTag::Post>()),
+              std::vector<int>({1, 3, 5, 7, 6, 4, 2}));
+    auto it = tree.erase(tree.find(4));
+    EXPECT_EQ(*it, 5);
+    auto pre = tree.erase(tree.cbegin<TraverseTag::Pre>());
+    EXPECT_TRUE(pre == tree.cbegin<TraverseTag::Pre>() || *pre == 1);
+    EXPECT_EQ(std::vector<int>(tree.cbegin<TraverseTag::In>(), tree.cend<TraverseTag::In>()),
+              std::vector<int>({1, 3, 5, 6, 7}));
+    ExpectReverseMatches<TraverseTag::Pre>(tree);
+    ExpectReverseMatches<TraverseTag::Post>(tree);
+}
+
+TEST(CompactBSTTest, FreeListReusesSlots) {
+    CompactBST<uint32_t> tree;
+    tree.reserve(1000);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        tree.insert(i);
+    }
+    size_t capacity = tree.capacity();
+    for (uint32_t i = 0; i < 1000; i += 2) {
+        EXPECT_EQ(tree.erase(i), 1);
+    }
+    for (uint32_t i = 1000; i < 1500; ++i) {
+        tree.insert(i);
+    }
+    EXPECT_EQ(tree.size(), 1000);
+    EXPECT_EQ(tree.capacity(), capacity);
+    EXPECT_EQ(*tree.cbegin<TraverseTag::In>(), 1);
+    EXPECT_LE(CompactBST<uint32_t>::slot_size, 16);
+    EXPECT_GE(sizeof(Node<uint32_t>), 2 * CompactBST<uint32_t>::slot_size);
+}
+
+TEST(CompactBSTTest, OwningKeysCopyMoveAndClear) {
+    CompactBST<std::string> tree;
+    for (int i = 0; i < 300; ++i) {
+        tree.insert(std::string(40, static_cast<char>('a' + i % 26)) + std::to_string(i));
+    }
+    for (int i = 0; i < 300; i += 3) {
+        tree.erase(std::string(40, static_cast<char>('a' + i % 26)) + std::to_string(i));
+    }
+    CompactBST<std::string> copy(tree);
+    EXPECT_TRUE(copy == tree);
+    copy.insert("zz");
+    EXPECT_TRUE(copy != tree);
+    CompactBST<std::string> moved(std::move(copy));
+    EXPECT_TRUE(copy.empty());
+    copy.insert("a");
+    EXPECT_EQ(copy.size(), 1);
+    EXPECT_EQ(moved.size(), 201);
+    moved = tree;
+    EXPECT_TRUE(moved == tree);
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+    EXPECT_TRUE(tree.cbegin<TraverseTag::Post>() == tree.cend<TraverseTag::Post>());
+    tree.insert("b");
+    EXPECT_EQ(*tree.cbegin<TraverseTag::In>(), "b");
+}
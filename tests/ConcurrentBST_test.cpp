@@ -0,0 +1,135 @@
+#include "../lib/ConcurrentBST.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ConcurrentBSTTest, SingleThreadedMatchesBST) {
+    std::mt19937 gen(17);
+    ConcurrentBST<int> tree;
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> reference;
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 2000) - 1000;
+        if (gen() % 3 != 0) {
+            EXPECT_EQ(tree.insert(key), reference.insert_check(key).second);
+        } else {
+            EXPECT_EQ(tree.erase(key), reference.erase(key));
+        }
+    }
+    EXPECT_EQ(tree.size(), reference.size());
+    for (int key = -1001; key < 1001; ++key) {
+        ASSERT_EQ(tree.contains(key), reference.find(key) != reference.end<TraverseTag::In>());
+    }
+    auto view = tree.read();
+    std::vector<int> keys(view.begin(), view.end());
+    std::vector<int> expected(reference.cbegin<TraverseTag::In>(), reference.cend<TraverseTag::In>());
+    EXPECT_EQ(keys, expected);
+
+    ConcurrentBST<std::string> words = {"b", "a", "c"};
+    EXPECT_EQ(words.erase("a"), 1);
+    EXPECT_FALSE(words.contains("a"));
+    EXPECT_TRUE(words.contains("c"));
+}
+
+TEST(ConcurrentBSTTest, ContendedInsertErase) {
+    constexpr int threads = 8;
+    constexpr int keys = 64;
+    ConcurrentBST<int> tree;
+    std::unique_ptr<std::atomic<int>[]> balance(new std::atomic<int>[keys]);
+    for (int i = 0; i < keys; ++i) {
+        balance[i].store(0);
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 gen(t + 1);
+            for (int i = 0; i < 20000; ++i) {
+                int key = static_cast<int>(gen() % keys);
+                if (gen() % 2 == 0) {
+                    if (tree.insert(key)) {
+                        balance[key].fetch_add(1);
+                    }
+                } else if (tree.erase(key) == 1) {
+                    balance[key].fetch_sub(1);
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    size_t present = 0;
+    for (int key = 0; key < keys; ++key) {
+        int count = balance[key].load();
+        ASSERT_TRUE(count == 0 || count == 1);
+        EXPECT_EQ(tree.contains(key), count == 1);
+        present += count;
+    }
+    EXPECT_EQ(tree.size(), present);
+    auto view = tree.read();
+    EXPECT_EQ(static_cast<size_t>(std::distance(view.begin(), view.end())), present);
+}
+
+TEST(ConcurrentBSTTest, IterationSeesStableKeys) {
+    ConcurrentBST<int> tree;
+    for (int i = 0; i < 1000; i += 2) {
+        tree.insert(i);
+    }
+    std::atomic<bool> done(false);
+    std::thread writer([&] {
+        std::mt19937 gen(3);
+        while (!done.load()) {
+            int key = 2 * static_cast<int>(gen() % 500) + 1;
+            tree.insert(key);
+            tree.erase(key);
+        }
+    });
+    for (int round = 0; round < 200; ++round) {
+        auto view = tree.read();
+        std::vector<int> keys(view.begin(), view.end());
+        ASSERT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+        ASSERT_TRUE(std::adjacent_find(keys.begin(), keys.end()) == keys.end());
+        size_t even = std::count_if(keys.begin(), keys.end(), [](int key) { return key % 2 == 0; });
+        ASSERT_EQ(even, 500);
+    }
+    done.store(true);
+    writer.join();
+}
+
+TEST(ConcurrentBSTTest, MoreViewsThanEpochSlots) {
+    ConcurrentBST<int> tree;
+    for (int i = 0; i < 100; ++i) {
+        tree.insert(i);
+    }
+    std::vector<ConcurrentBST<int>::view> views;
+    for (int i = 0; i < 200; ++i) {
+        views.push_back(tree.read());
+    }
+    std::atomic<int> pinned{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 200; ++t) {
+        threads.emplace_back([&] {
+            auto view = tree.read();
+            pinned.fetch_add(1);
+            while (pinned.load() < 200) {
+                std::this_thread::yield();
+            }
+            EXPECT_EQ(std::distance(view.begin(), view.end()), 100);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(tree.erase(i));
+    }
+    EXPECT_EQ(std::distance(views.back().begin(), views.back().end()), 0);
+    views.clear();
+    auto last = tree.read();
+    EXPECT_TRUE(last.begin() == last.end());
+}
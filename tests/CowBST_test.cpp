@@ -0,0 +1,150 @@
+#include "../lib/CowBST.h"
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef CowBST<int, std::allocator<Node<int> >, RedBlackPolicy> CowTree;
+
+std::vector<int> Keys(const CowTree& tree) {
+    return std::vector<int>(tree.cbegin<TraverseTag::In>(), tree.cend<TraverseTag::In>());
+}
+
+TEST(CowBSTTest, CopiesShareUntilWritten) {
+    CowTree a = {5, 3, 8, 1, 4};
+    CowTree b(a);
+    CowTree c;
+    c = a;
+    EXPECT_TRUE(a.shared());
+    EXPECT_EQ(&a.tree(), &b.tree());
+    EXPECT_EQ(&a.tree(), &c.tree());
+    EXPECT_TRUE(b == a);
+
+    b.insert(7);
+    EXPECT_NE(&a.tree(), &b.tree());
+    EXPECT_EQ(Keys(a), std::vector<int>({1, 3, 4, 5, 8}));
+    EXPECT_EQ(Keys(b), std::vector<int>({1, 3, 4, 5, 7, 8}));
+    EXPECT_EQ(&a.tree(), &c.tree());
+
+    c.erase(3);
+    EXPECT_FALSE(a.shared());
+    EXPECT_EQ(Keys(a), std::vector<int>({1, 3, 4, 5, 8}));
+    EXPECT_EQ(Keys(c), std::vector<int>({1, 4, 5, 8}));
+
+    const int* before = &*a.find(4);
+    a.insert(2);
+    EXPECT_EQ(&*a.find(4), before);
+}
+
+TEST(CowBSTTest, NoOpWritesKeepSharing) {
+    CowTree a = {1, 2, 3};
+    CowTree b = a;
+    EXPECT_FALSE(b.insert_check(2).second);
+    EXPECT_EQ(*b.insert(3), 3);
+    EXPECT_EQ(b.erase(10), 0);
+    EXPECT_TRUE(b.extract(10).empty());
+    EXPECT_EQ(&a.tree(), &b.tree());
+}
+
+TEST(CowBSTTest, EraseByPositionInSharedTree) {
+    CowTree a = {10, 20, 30, 40};
+    CowTree b = a;
+    auto next = b.erase(b.find(20));
+    ASSERT_TRUE(next != b.end<TraverseTag::In>());
+    EXPECT_EQ(*next, 30);
+    EXPECT_EQ(Keys(a), std::vector<int>({10, 20, 30, 40}));
+    EXPECT_EQ(Keys(b), std::vector<int>({10, 30, 40}));
+}
+
+TEST(CowBSTTest, ClearExtractAndMerge) {
+    CowTree a = {1, 2, 3, 4};
+    CowTree b = a;
+    b.clear();
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(a.size(), 4);
+
+    CowTree c = a;
+    auto handle = c.extract(2);
+    ASSERT_FALSE(handle.empty());
+    EXPECT_EQ(handle.value(), 2);
+    EXPECT_EQ(a.size(), 4);
+    b.insert(std::move(handle));
+    EXPECT_EQ(Keys(b), std::vector<int>({2}));
+
+    CowTree d = a;
+    b.merge(d);
+    EXPECT_EQ(Keys(b), std::vector<int>({1, 2, 3, 4}));
+    EXPECT_EQ(Keys(a), std::vector<int>({1, 2, 3, 4}));
+    EXPECT_TRUE(d.empty());
+
+    CowTree moved = std::move(a);
+    EXPECT_TRUE(a.empty());
+    a.insert(9);
+    EXPECT_EQ(moved.size(), 4);
+}
+
+TEST(CowBSTTest, ClonesKeepPoolAllocator) {
+    typedef CowBST<int, BSTNodePool<Node<int> >, AVLPolicy> PoolTree;
+    PoolTree a = {1, 2, 3};
+    PoolTree b = a;
+    b.insert(4);
+    EXPECT_FALSE(a.shared());
+    EXPECT_TRUE(a.get_allocator() == b.get_allocator());
+
+    auto handle = b.extract(4);
+    a.insert(std::move(handle));
+    PoolTree c = a;
+    c.insert(7);
+    a.merge(c);
+    EXPECT_EQ(std::vector<int>(a.cbegin<TraverseTag::In>(), a.cend<TraverseTag::In>()), std::vector<int>({1, 2, 3, 4, 7}));
+    EXPECT_TRUE(c.empty());
+    EXPECT_EQ(b.size(), 3);
+}
+
+TEST(CowBSTTest, CopiesReadOnOtherThreads) {
+    CowBST<std::string> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(std::to_string(i));
+    }
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([copy = tree] {
+            size_t count = 0;
+            for (auto it = copy.cbegin<TraverseTag::In>(); it != copy.cend<TraverseTag::In>(); ++it) {
+                ++count;
+            }
+            EXPECT_EQ(count, 1000);
+            EXPECT_TRUE(copy.find("500") != copy.end<TraverseTag::In>());
+        });
+    }
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_FALSE(tree.shared());
+}
+
+TEST(CowBSTTest, WritesInPlaceAfterReaderDropsCopy) {
+    CowBST<std::string> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(std::to_string(i));
+    }
+    const CowBST<std::string>::tree_type* nodes = &tree.tree();
+    std::thread reader([copy = tree]() mutable {
+        size_t count = 0;
+        for (auto it = copy.cbegin<TraverseTag::In>(); it != copy.cend<TraverseTag::In>(); ++it) {
+            count += (*it).size();
+        }
+        EXPECT_EQ(count, 2890);
+        CowBST<std::string> dropped = std::move(copy);
+    });
+    // no join before the writes: only the ownership count orders the reader's loads before them
+    while (tree.shared()) {
+        std::this_thread::yield();
+    }
+    tree.erase("500");
+    tree.insert("abc");
+    EXPECT_EQ(&tree.tree(), nodes);
+    reader.join();
+    EXPECT_EQ(tree.size(), 1000);
+}
@@ -0,0 +1,71 @@
+#include "../lib/FrozenBST.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST(FrozenBSTTest, EmptyTree) {
+    FrozenBST<int> frozen{BST<int>()};
+    EXPECT_TRUE(frozen.empty());
+    EXPECT_TRUE(frozen.begin() == frozen.end());
+    EXPECT_TRUE(frozen.find(1) == frozen.end());
+    EXPECT_FALSE(frozen.contains(1));
+}
+
+TEST(FrozenBSTTest, InorderIteration) {
+    for (int n = 1; n <= 70; ++n) {
+        BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree(sorted_unique, 0, n);
+        FrozenBST<int> frozen(tree);
+        EXPECT_EQ(frozen.size(), static_cast<size_t>(n));
+        std::vector<int> forward(frozen.begin<TraverseTag::In>(), frozen.end<TraverseTag::In>());
+        std::vector<int> backward(frozen.rbegin(), frozen.rend());
+        std::vector<int> expected(tree.cbegin<TraverseTag::In>(), tree.cend<TraverseTag::In>());
+        EXPECT_EQ(forward, expected);
+        std::reverse(expected.begin(), expected.end());
+        EXPECT_EQ(backward, expected);
+    }
+}
+
+TEST(FrozenBSTTest, LookupsMatchTree) {
+    std::mt19937 gen(5);
+    BST<int> tree;
+    for (int i = 0; i < 5000; ++i) {
+        tree.insert(static_cast<int>(gen() % 20000));
+    }
+    FrozenBST<int> frozen(tree);
+    EXPECT_EQ(frozen.size(), tree.size());
+    for (int key = -5; key < 20005; ++key) {
+        auto it = tree.find(key);
+        auto frozen_it = frozen.find(key);
+        ASSERT_EQ(it == tree.end<TraverseTag::In>(), frozen_it == frozen.end());
+        if (frozen_it != frozen.end()) {
+            EXPECT_EQ(*frozen_it, key);
+        }
+        auto lower = tree.lower_bound(key);
+        auto frozen_lower = frozen.lower_bound(key);
+        ASSERT_EQ(lower == tree.end<TraverseTag::In>(), frozen_lower == frozen.end());
+        if (frozen_lower != frozen.end()) {
+            EXPECT_EQ(*frozen_lower, *lower);
+        }
+        auto upper = tree.upper_bound(key);
+        auto frozen_upper = frozen.upper_bound(key);
+        ASSERT_EQ(upper == tree.end<TraverseTag::In>(), frozen_upper == frozen.end());
+        if (frozen_upper != frozen.end()) {
+            EXPECT_EQ(*frozen_upper, *upper);
+        }
+    }
+}
+
+TEST(FrozenBSTTest, TransparentCompare) {
+    BST<std::string, std::allocator<Node<std::string> >, NoBalancePolicy, std::less<> > tree = {"pear", "apple", "fig", "kiwi"};
+    FrozenBST<std::string, std::less<> > frozen(tree);
+    EXPECT_TRUE(frozen.contains(std::string_view("fig")));
+    EXPECT_FALSE(frozen.contains(std::string_view("plum")));
+    EXPECT_EQ(*frozen.upper_bound(std::string_view("fig")), "kiwi");
+    EXPECT_EQ(*frozen.lower_bound(std::string_view("fig")), "apple");
+    EXPECT_EQ(*frozen.begin(), "apple");
+    EXPECT_EQ(*std::prev(frozen.end()), "pear");
+}
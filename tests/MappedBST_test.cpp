@@ -0,0 +1,101 @@
+#include "../lib/MappedBST.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+std::string ImagePath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("BST_test_" + name + ".img")).string();
+}
+
+TEST(MappedBSTTest, RoundTripMatchesTree) {
+    std::mt19937 gen(41);
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> tree;
+    for (int i = 0; i < 5000; ++i) {
+        tree.insert(static_cast<int>(gen() % 20000));
+    }
+    std::string path = ImagePath("round_trip");
+    ASSERT_TRUE(tree.save(path));
+    std::optional<MappedBST<int> > mapped = MappedBST<int>::open(path);
+    ASSERT_TRUE(mapped.has_value());
+    EXPECT_EQ(mapped->size(), tree.size());
+    std::vector<int> keys(mapped->begin(), mapped->end());
+    EXPECT_EQ(keys, std::vector<int>(tree.cbegin<TraverseTag::In>(), tree.cend<TraverseTag::In>()));
+    for (int key = -5; key < 20005; ++key) {
+        ASSERT_EQ(mapped->contains(key), tree.find(key) != tree.end<TraverseTag::In>());
+        auto lower = tree.lower_bound(key);
+        auto mapped_lower = mapped->lower_bound(key);
+        ASSERT_EQ(lower == tree.end<TraverseTag::In>(), mapped_lower == mapped->end());
+        if (mapped_lower != mapped->end()) {
+            EXPECT_EQ(*mapped_lower, *lower);
+        }
+        auto upper = tree.upper_bound(key);
+        auto mapped_upper = mapped->upper_bound(key);
+        ASSERT_EQ(upper == tree.end<TraverseTag::In>(), mapped_upper == mapped->end());
+        if (mapped_upper != mapped->end()) {
+            EXPECT_EQ(*mapped_upper, *upper);
+        }
+    }
+
+    MappedBST<int> moved = std::move(*mapped);
+    EXPECT_TRUE(mapped->empty());
+    EXPECT_EQ(moved.size(), tree.size());
+    EXPECT_EQ(*moved.begin(), *tree.cbegin<TraverseTag::In>());
+    std::remove(path.c_str());
+}
+
+struct Point {
+    int x;
+    int y;
+};
+
+struct PointLess {
+    bool operator()(const Point& a, const Point& b) const { return a.x != b.x ? a.x < b.x : a.y < b.y; }
+};
+
+TEST(MappedBSTTest, StructKeysAndEmptyTree) {
+    BST<Point, std::allocator<Node<Point> >, AVLPolicy, PointLess> points = {{3, 1}, {1, 2}, {1, 1}, {2, 5}};
+    std::string path = ImagePath("points");
+    ASSERT_TRUE(points.save(path));
+    auto mapped = MappedBST<Point, PointLess>::open(path);
+    ASSERT_TRUE(mapped.has_value());
+    EXPECT_TRUE(mapped->contains({2, 5}));
+    EXPECT_FALSE(mapped->contains({2, 4}));
+    EXPECT_EQ(mapped->upper_bound({1, 2})->x, 2);
+
+    BST<int> empty;
+    ASSERT_TRUE(empty.save(path));
+    auto mapped_empty = MappedBST<int>::open(path);
+    ASSERT_TRUE(mapped_empty.has_value());
+    EXPECT_TRUE(mapped_empty->empty());
+    EXPECT_TRUE(mapped_empty->begin() == mapped_empty->end());
+    EXPECT_FALSE(mapped_empty->contains(0));
+    std::remove(path.c_str());
+}
+
+TEST(MappedBSTTest, RejectsBadImages) {
+    BST<int> tree = {4, 2, 6, 1, 3, 5, 7};
+    std::string path = ImagePath("bad");
+    EXPECT_FALSE(MappedBST<int>::open(path + ".missing").has_value());
+    ASSERT_TRUE(tree.save(path));
+    EXPECT_FALSE(MappedBST<long long>::open(path).has_value());
+    EXPECT_FALSE(MappedBST<short>::open(path).has_value());
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(BSTImageHeader::keys_offset + 2);
+        file.put('\x7f');
+    }
+    EXPECT_FALSE(MappedBST<int>::open(path).has_value());
+    EXPECT_TRUE(MappedBST<int>::open(path, false).has_value());
+
+    std::filesystem::resize_file(path, BSTImageHeader::keys_offset + 3 * sizeof(int));
+    EXPECT_FALSE(MappedBST<int>::open(path, false).has_value());
+    std::filesystem::resize_file(path, 10);
+    EXPECT_FALSE(MappedBST<int>::open(path, false).has_value());
+    std::remove(path.c_str());
+}
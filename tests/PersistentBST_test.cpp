@@ -0,0 +1,140 @@
+#include "../lib/PersistentBST.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+TEST(PersistentBSTTest, SingleThreadedMatchesBST) {
+    std::mt19937 gen(29);
+    PersistentBST<int> tree;
+    BST<int, std::allocator<Node<int> >, AVLPolicy> reference;
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 3000);
+        if (gen() % 3 != 0) {
+            EXPECT_EQ(tree.insert(key), reference.insert_check(key).second);
+        } else {
+            EXPECT_EQ(tree.erase(key), reference.erase(key));
+        }
+    }
+    EXPECT_EQ(tree.size(), reference.size());
+    std::vector<int> keys(tree.begin(), tree.end());
+    std::vector<int> expected(reference.cbegin<TraverseTag::In>(), reference.cend<TraverseTag::In>());
+    EXPECT_EQ(keys, expected);
+    std::vector<int> backward(std::make_reverse_iterator(tree.end()), std::make_reverse_iterator(tree.begin()));
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(backward, expected);
+    for (int key = -1; key < 3001; ++key) {
+        ASSERT_EQ(tree.contains(key), reference.find(key) != reference.end<TraverseTag::In>());
+        auto lower = tree.lower_bound(key);
+        auto reference_lower = reference.lower_bound(key);
+        ASSERT_EQ(lower == tree.end(), reference_lower == reference.end<TraverseTag::In>());
+        if (lower != tree.end()) {
+            EXPECT_EQ(*lower, *reference_lower);
+        }
+        auto upper = tree.upper_bound(key);
+        auto reference_upper = reference.upper_bound(key);
+        ASSERT_EQ(upper == tree.end(), reference_upper == reference.end<TraverseTag::In>());
+        if (upper != tree.end()) {
+            EXPECT_EQ(*upper, *reference_upper);
+        }
+    }
+}
+
+TEST(PersistentBSTTest, SnapshotsKeepTheirVersion) {
+    std::mt19937 gen(31);
+    PersistentBST<int> tree;
+    std::vector<PersistentBST<int>::version> versions;
+    std::vector<std::vector<int> > expected;
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 100; ++i) {
+            int key = static_cast<int>(gen() % 500);
+            if (gen() % 4 != 0) {
+                tree.insert(key);
+            } else {
+                tree.erase(key);
+            }
+        }
+        versions.push_back(tree.snapshot());
+        expected.emplace_back(tree.begin(), tree.end());
+    }
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+    for (size_t i = 0; i < versions.size(); ++i) {
+        EXPECT_EQ(versions[i].size(), expected[i].size());
+        EXPECT_EQ(std::vector<int>(versions[i].begin(), versions[i].end()), expected[i]);
+    }
+    PersistentBST<int> copy = tree;
+    copy.insert(1);
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(copy.size(), 1);
+}
+
+struct CountedKey {
+    static inline int alive = 0;
+
+    int value;
+
+    CountedKey(int v) : value(v) { ++alive; }
+    CountedKey(const CountedKey& other) : value(other.value) { ++alive; }
+    ~CountedKey() { --alive; }
+
+    bool operator<(const CountedKey& other) const { return value < other.value; }
+};
+
+TEST(PersistentBSTTest, MemoryGrowsWithChangesNotSnapshots) {
+    {
+        PersistentBST<CountedKey> tree;
+        for (int i = 0; i < 4096; ++i) {
+            tree.insert(i);
+        }
+        EXPECT_EQ(CountedKey::alive, 4096);
+        std::vector<PersistentBST<CountedKey>::version> versions;
+        for (int i = 0; i < 1000; ++i) {
+            versions.push_back(tree.snapshot());
+        }
+        EXPECT_EQ(CountedKey::alive, 4096);
+        for (int i = 0; i < 100; ++i) {
+            tree.insert(10000 + i);
+            versions.push_back(tree.snapshot());
+        }
+        // each insert copies one root-to-leaf path of an AVL tree with about 4096 keys
+        EXPECT_LE(CountedKey::alive, 4096 + 100 * 16);
+        versions.clear();
+        EXPECT_EQ(CountedKey::alive, 4196);
+    }
+    EXPECT_EQ(CountedKey::alive, 0);
+}
+
+TEST(PersistentBSTTest, SnapshotsReadWhileWriting) {
+    PersistentBST<int> tree;
+    for (int i = 0; i < 1000; i += 2) {
+        tree.insert(i);
+    }
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&, version = tree.snapshot()] {
+            while (!done.load()) {
+                std::vector<int> keys(version.begin(), version.end());
+                ASSERT_EQ(keys.size(), 500);
+                ASSERT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+            }
+        });
+    }
+    std::mt19937 gen(37);
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 1000);
+        if (gen() % 2 == 0) {
+            tree.insert(key);
+        } else {
+            tree.erase(key);
+        }
+    }
+    done.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+}
@@ -0,0 +1,115 @@
+#include "../lib/RcuBST.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(RcuBSTTest, SingleThreadedMatchesBST) {
+    std::mt19937 gen(13);
+    RcuBST<int> tree;
+    BST<int, std::allocator<Node<int> >, AVLPolicy> reference;
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 3000);
+        if (gen() % 3 != 0) {
+            EXPECT_EQ(tree.insert(key), reference.insert_check(key).second);
+        } else {
+            EXPECT_EQ(tree.erase(key), reference.erase(key));
+        }
+    }
+    auto view = tree.read();
+    EXPECT_EQ(view.size(), reference.size());
+    EXPECT_EQ(tree.size(), reference.size());
+    std::vector<int> keys(view.begin(), view.end());
+    std::vector<int> expected(reference.cbegin<TraverseTag::In>(), reference.cend<TraverseTag::In>());
+    EXPECT_EQ(keys, expected);
+    for (int key = -1; key < 3001; ++key) {
+        ASSERT_EQ(view.contains(key), reference.find(key) != reference.end<TraverseTag::In>());
+        auto lower = view.lower_bound(key);
+        auto reference_lower = reference.lower_bound(key);
+        ASSERT_EQ(lower == view.end(), reference_lower == reference.end<TraverseTag::In>());
+        if (lower != view.end()) {
+            EXPECT_EQ(*lower, *reference_lower);
+        }
+        auto upper = view.upper_bound(key);
+        auto reference_upper = reference.upper_bound(key);
+        ASSERT_EQ(upper == view.end(), reference_upper == reference.end<TraverseTag::In>());
+        if (upper != view.end()) {
+            EXPECT_EQ(*upper, *reference_upper);
+        }
+    }
+    EXPECT_EQ(*std::prev(view.end()), *reference.rbegin<TraverseTag::In>());
+}
+
+TEST(RcuBSTTest, SnapshotIsStable) {
+    RcuBST<std::string> tree = {"b", "a", "c"};
+    auto before = tree.read();
+    tree.erase("b");
+    tree.insert("d");
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(std::vector<std::string>(before.begin(), before.end()), (std::vector<std::string>{"a", "b", "c"}));
+    EXPECT_TRUE(tree.read().empty());
+}
+
+TEST(RcuBSTTest, ManySnapshotsFromOneThread) {
+    RcuBST<int> tree;
+    std::vector<RcuBST<int>::snapshot> snapshots;
+    for (int i = 0; i < 300; ++i) {
+        tree.insert(i);
+        snapshots.push_back(tree.read());
+    }
+    for (int i = 0; i < 300; i += 2) {
+        tree.erase(i);
+    }
+    for (int i = 0; i < 300; ++i) {
+        EXPECT_EQ(snapshots[i].size(), static_cast<size_t>(i + 1));
+        EXPECT_TRUE(snapshots[i].contains(i));
+    }
+    EXPECT_EQ(tree.read().size(), 150);
+}
+
+TEST(RcuBSTTest, ReadersRunAlongsideWriter) {
+    constexpr int count = 20000;
+    RcuBST<int> tree;
+    std::atomic<bool> done(false);
+    std::atomic<int> failures(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                auto view = tree.read();
+                int expected = -1;
+                size_t seen = 0;
+                for (int key : view) {
+                    if (expected != -1 && key != expected) {
+                        failures.fetch_add(1);
+                    }
+                    expected = key + 1;
+                    ++seen;
+                }
+                if (seen != view.size()) {
+                    failures.fetch_add(1);
+                }
+                if (!view.empty() && !view.contains(*view.begin())) {
+                    failures.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (int i = 0; i < count; ++i) {
+        tree.insert(i);
+    }
+    for (int i = 0; i < count; ++i) {
+        tree.erase(i);
+    }
+    done.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_TRUE(tree.empty());
+}
@@ -0,0 +1,176 @@
+#include "../lib/ShardedBST.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+TEST(ShardedBSTTest, SingleThreadedMatchesBST) {
+    std::mt19937 gen(17);
+    ShardedBST<int> tree({500, 1000, 2000});
+    BST<int, std::allocator<Node<int> >, RedBlackPolicy> reference;
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(gen() % 3000);
+        if (gen() % 3 != 0) {
+            EXPECT_EQ(tree.insert(key), reference.insert_check(key).second);
+        } else {
+            EXPECT_EQ(tree.erase(key), reference.erase(key));
+        }
+    }
+    EXPECT_EQ(tree.shard_count(), 4);
+    EXPECT_EQ(tree.size(), reference.size());
+    auto view = tree.read();
+    std::vector<int> keys(view.begin(), view.end());
+    std::vector<int> expected(reference.cbegin<TraverseTag::In>(), reference.cend<TraverseTag::In>());
+    EXPECT_EQ(keys, expected);
+    for (int key = -1; key < 3001; ++key) {
+        ASSERT_EQ(tree.contains(key), reference.find(key) != reference.end<TraverseTag::In>());
+    }
+}
+
+TEST(ShardedBSTTest, EmptyShardsAreSkipped) {
+    ShardedBST<int> tree({10, 20, 20, 30}, {1, 25, 40});
+    EXPECT_EQ(tree.shard_size(0), 1);
+    EXPECT_EQ(tree.shard_size(1), 0);
+    EXPECT_EQ(tree.shard_size(2), 0);
+    EXPECT_EQ(tree.shard_size(3), 1);
+    {
+        auto view = tree.read();
+        EXPECT_EQ(std::vector<int>(view.begin(), view.end()), std::vector<int>({1, 25, 40}));
+    }
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+    auto cleared = tree.read();
+    EXPECT_TRUE(cleared.begin() == cleared.end());
+}
+
+TEST(ShardedBSTTest, RebalanceEvensOutSkewedShards) {
+    ShardedBST<int> tree({100, 200, 300});
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(i);
+    }
+    EXPECT_EQ(tree.shard_size(3), 700);
+    EXPECT_TRUE(tree.rebalance());
+    EXPECT_FALSE(tree.rebalance());
+    for (size_t i = 0; i < tree.shard_count(); ++i) {
+        EXPECT_EQ(tree.shard_size(i), 250);
+    }
+    EXPECT_EQ(tree.split_points(), std::vector<int>({250, 500, 750}));
+    for (int i = 0; i < 1000; i += 3) {
+        EXPECT_EQ(tree.erase(i), 1);
+    }
+    for (int i = 0; i < 150; ++i) {
+        EXPECT_TRUE(tree.insert(-i - 1));
+    }
+    EXPECT_TRUE(tree.rebalance(1.0));
+    size_t total = tree.size();
+    for (size_t i = 0; i < tree.shard_count(); ++i) {
+        EXPECT_LE(tree.shard_size(i), total / tree.shard_count() + 1);
+    }
+    auto view = tree.read();
+    std::vector<int> keys(view.begin(), view.end());
+    EXPECT_EQ(keys.size(), total);
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+    for (int key = -200; key < 1000; ++key) {
+        ASSERT_EQ(tree.contains(key), std::binary_search(keys.begin(), keys.end(), key));
+    }
+}
+
+TEST(ShardedBSTTest, RebalancePullsAcrossEmptyShards) {
+    ShardedBST<int> tree({0, 0, 0, 0, 0});
+    for (int i = 0; i < 600; ++i) {
+        tree.insert(i);
+    }
+    EXPECT_EQ(tree.shard_size(5), 600);
+    EXPECT_TRUE(tree.rebalance());
+    for (size_t i = 0; i < tree.shard_count(); ++i) {
+        EXPECT_EQ(tree.shard_size(i), 100);
+    }
+    auto view = tree.read();
+    std::vector<int> keys(view.begin(), view.end());
+    EXPECT_EQ(keys.size(), 600);
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+}
+
+TEST(ShardedBSTTest, ContendedWritersWithRebalance) {
+    constexpr int threads = 8;
+    constexpr int keys = 4096;
+    ShardedBST<int> tree({64, 128, 192});
+    std::unique_ptr<std::atomic<int>[]> balance(new std::atomic<int>[keys]);
+    for (int i = 0; i < keys; ++i) {
+        balance[i].store(0);
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 gen(t + 1);
+            for (int i = 0; i < 20000; ++i) {
+                int key = static_cast<int>(gen() % keys);
+                if (gen() % 3 != 0) {
+                    if (tree.insert(key)) {
+                        balance[key].fetch_add(1);
+                    }
+                } else if (tree.erase(key) == 1) {
+                    balance[key].fetch_sub(1);
+                }
+                if (t == 0 && i % 1000 == 0) {
+                    tree.rebalance();
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    size_t present = 0;
+    for (int key = 0; key < keys; ++key) {
+        int count = balance[key].load();
+        ASSERT_TRUE(count == 0 || count == 1);
+        EXPECT_EQ(tree.contains(key), count == 1);
+        present += count;
+    }
+    EXPECT_EQ(tree.size(), present);
+    auto view = tree.read();
+    std::vector<int> seen(view.begin(), view.end());
+    EXPECT_EQ(seen.size(), present);
+    EXPECT_TRUE(std::is_sorted(seen.begin(), seen.end()));
+}
+
+TEST(ShardedBSTTest, KeysStayVisibleWhileRebalanceMovesThem) {
+    constexpr int keys = 10000;
+    ShardedBST<int> tree({100, 200, 300});
+    for (int i = 0; i < keys; ++i) {
+        tree.insert(i);
+    }
+    std::atomic<bool> done{false};
+    std::atomic<int> missing{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&, t] {
+            while (!done.load()) {
+                for (int key = t; key < keys; key += 7) {
+                    if (!tree.contains(key)) {
+                        missing.fetch_add(1);
+                    }
+                }
+            }
+        });
+    }
+    EXPECT_TRUE(tree.rebalance());
+    for (int i = 1; i <= 3 * keys; ++i) {
+        tree.insert(-i);
+    }
+    EXPECT_TRUE(tree.rebalance(1.0));
+    done.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(missing.load(), 0);
+    for (size_t i = 0; i < tree.shard_count(); ++i) {
+        EXPECT_EQ(tree.shard_size(i), keys);
+    }
+    EXPECT_EQ(tree.split_points(), std::vector<int>({-20000, -10000, 0}));
+}